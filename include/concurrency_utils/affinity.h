@@ -0,0 +1,296 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * thread placement: NUMA topology, cpu pinning and the thread pool configuration.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#    define CONCURRENCY_UTILS_HAS_AFFINITY
+#endif
+
+namespace concurrency_utils
+{
+
+/** a NUMA node. */
+struct numa_node
+{
+    /** the node's id, as reported by the operating system. */
+    std::size_t id{0};
+
+    /** the node's cpus. */
+    std::vector<std::size_t> cpus;
+};
+
+namespace detail
+{
+
+/** parse a cpu list of the form "0-3,8,10-11". */
+inline std::vector<std::size_t> parse_cpu_list(const std::string& list)
+{
+    std::vector<std::size_t> cpus;
+
+    std::size_t pos = 0;
+    while(pos < list.size())
+    {
+        auto end = list.find(',', pos);
+        if(end == std::string::npos)
+        {
+            end = list.size();
+        }
+
+        auto range = list.substr(pos, end - pos);
+        auto dash = range.find('-');
+        try
+        {
+            auto first = std::stoul(range.substr(0, dash));
+            auto last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+            for(auto cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        catch(const std::exception&)
+        {
+            // ignore malformed entries, e.g. the trailing newline.
+        }
+
+        pos = end + 1;
+    }
+
+    return cpus;
+}
+
+} /* namespace detail */
+
+/**
+ * return the NUMA nodes of the system, read from /sys/devices/system/node on Linux. if no topology information
+ * is available, a single node holding all cpus is returned.
+ */
+inline std::vector<numa_node> get_numa_nodes()
+{
+    std::vector<numa_node> nodes;
+
+#if defined(__linux__)
+    std::ifstream online{"/sys/devices/system/node/online"};
+    std::string online_list;
+    if(std::getline(online, online_list))
+    {
+        for(auto id: detail::parse_cpu_list(online_list))
+        {
+            std::ifstream cpulist{"/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"};
+            std::string list;
+            if(std::getline(cpulist, list))
+            {
+                auto cpus = detail::parse_cpu_list(list);
+                if(!cpus.empty())
+                {
+                    nodes.push_back({id, std::move(cpus)});
+                }
+            }
+        }
+    }
+#endif
+
+    if(nodes.empty())
+    {
+        numa_node node;
+        node.cpus.resize(std::max(std::thread::hardware_concurrency(), 1u));
+        for(std::size_t i = 0; i < node.cpus.size(); ++i)
+        {
+            node.cpus[i] = i;
+        }
+        nodes.push_back(std::move(node));
+    }
+
+    return nodes;
+}
+
+/** pin the calling thread to a set of cpus. an empty set leaves the thread unpinned. returns false if pinning is not supported or failed. */
+inline bool pin_this_thread(const std::vector<std::size_t>& cpus)
+{
+    if(cpus.empty())
+    {
+        return true;
+    }
+
+#if defined(CONCURRENCY_UTILS_HAS_AFFINITY)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(auto cpu: cpus)
+    {
+        if(cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * thread pool configuration.
+ *
+ * without a cpu list and without spreading, the workers are not pinned, which is the behavior of
+ * deferred_thread_pool{thread_count}.
+ */
+struct pool_config
+{
+    /** number of worker threads. 0 creates one thread per entry of the cpu list, or a single thread if the list is empty. */
+    std::size_t thread_count{0};
+
+    /** cpus to pin the workers to. worker i is pinned to cpus[i % cpus.size()]. if spread_numa_nodes is set, the list restricts the usable cpus instead. */
+    std::vector<std::size_t> cpus;
+
+    /** distribute the workers round-robin over the NUMA nodes, and pin each worker to the cpus of its node. */
+    bool spread_numa_nodes{false};
+
+    /** give each NUMA node its own task queue. workers prefer the queue of their node and only take tasks from other nodes' queues if it is empty. */
+    bool queue_per_node{false};
+};
+
+namespace detail
+{
+
+/** placement of a worker thread. */
+struct worker_placement
+{
+    /** the worker's node, as an index into the pool's node list. */
+    std::size_t node{0};
+
+    /** the worker's task queue. */
+    std::size_t queue{0};
+
+    /** the worker's index among the consumers of its queue. */
+    std::size_t queue_consumer{0};
+
+    /** the cpus the worker is pinned to. empty if not pinned. */
+    std::vector<std::size_t> cpus;
+};
+
+/** placement of all workers of a pool. */
+struct pool_placement
+{
+    /** the nodes the workers are distributed over. holds a single entry if the workers are not spread. */
+    std::vector<numa_node> nodes;
+
+    /** number of task queues. */
+    std::size_t queue_count{1};
+
+    /** number of consumers per queue. */
+    std::vector<std::size_t> queue_consumers;
+
+    /** per-worker placement. */
+    std::vector<worker_placement> workers;
+};
+
+/** resolve a pool configuration into worker placements. creates at least one worker. */
+inline pool_placement make_placement(const pool_config& config)
+{
+    pool_placement placement;
+
+    if(config.spread_numa_nodes)
+    {
+        for(auto& node: get_numa_nodes())
+        {
+            // restrict the node to the configured cpus.
+            if(!config.cpus.empty())
+            {
+                auto& cpus = node.cpus;
+                cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&config](std::size_t cpu) -> bool
+                                          { return std::find(config.cpus.begin(), config.cpus.end(), cpu) == config.cpus.end(); }),
+                           cpus.end());
+            }
+
+            if(!node.cpus.empty())
+            {
+                placement.nodes.push_back(std::move(node));
+            }
+        }
+    }
+
+    if(placement.nodes.empty())
+    {
+        placement.nodes.push_back({0, config.cpus});
+    }
+
+    std::size_t thread_count = config.thread_count;
+    if(!thread_count)
+    {
+        thread_count = std::max<std::size_t>(config.cpus.size(), 1);
+    }
+
+    // only use as many nodes as there are workers, so that every queue has a consumer.
+    if(placement.nodes.size() > thread_count)
+    {
+        placement.nodes.resize(thread_count);
+    }
+
+    placement.queue_count = config.queue_per_node ? placement.nodes.size() : 1;
+    placement.queue_consumers.assign(placement.queue_count, 0);
+
+    placement.workers.resize(thread_count);
+    for(std::size_t i = 0; i < thread_count; ++i)
+    {
+        auto& worker = placement.workers[i];
+        worker.node = i % placement.nodes.size();
+        worker.queue = config.queue_per_node ? worker.node : 0;
+        worker.queue_consumer = placement.queue_consumers[worker.queue]++;
+
+        if(config.spread_numa_nodes)
+        {
+            worker.cpus = placement.nodes[worker.node].cpus;
+        }
+        else if(!config.cpus.empty())
+        {
+            worker.cpus = {config.cpus[i % config.cpus.size()]};
+        }
+    }
+
+    return placement;
+}
+
+/** check whether the workers of a placement are placed the same way in another placement, i.e., whether the pool can switch to the other placement by adding or removing workers at the end. */
+inline bool is_placement_prefix(const pool_placement& current, const pool_placement& other)
+{
+    if(current.nodes.size() != other.nodes.size() || current.queue_count != other.queue_count)
+    {
+        return false;
+    }
+
+    const auto count = std::min(current.workers.size(), other.workers.size());
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const auto& a = current.workers[i];
+        const auto& b = other.workers[i];
+        if(a.node != b.node || a.queue != b.queue || a.queue_consumer != b.queue_consumer || a.cpus != b.cpus)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} /* namespace detail */
+
+} /* namespace concurrency_utils */
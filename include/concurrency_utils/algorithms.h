@@ -0,0 +1,388 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * parallel algorithms on top of deferred_thread_pool: sort, inclusive scan, transform-reduce and copy_if.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "parallel.h"
+
+namespace concurrency_utils
+{
+
+namespace detail
+{
+
+/**
+ * minimum size of a block of work, in bytes. a block of this size amortizes the cost of its task, and it stays in the
+ * L1/L2 cache between the passes of an algorithm. ranges below two blocks are processed by the calling thread.
+ */
+constexpr std::size_t min_block_bytes = 16 * 1024;
+
+/** minimum number of elements of type T in a block. */
+template<typename T>
+constexpr std::size_t min_block_elements()
+{
+    return std::max<std::size_t>(min_block_bytes / sizeof(T), 1);
+}
+
+/** number of blocks to split length elements of type T into: at most one per worker, and none smaller than min_block_elements. */
+template<typename T>
+std::size_t block_count(std::size_t length, std::size_t thread_count)
+{
+    return std::min(std::max<std::size_t>(thread_count, 1), std::max<std::size_t>(length / min_block_elements<T>(), 1));
+}
+
+/** push one task per block, calling f(b) for all b in [0, count), and run the pool. */
+template<typename Pool, typename F>
+void run_blocks(Pool& pool, std::size_t count, F& f)
+{
+    // the tasks only capture a pointer and an index, which fits into the small buffer of std::function.
+    for(std::size_t b = 0; b < count; ++b)
+    {
+        pool.push_task([f = &f, b]()
+                       { (*f)(b); });
+    }
+
+    pool.run_tasks_and_wait();
+}
+
+/**
+ * return the number of elements a stable merge of the sorted ranges a and b takes from a for its first k outputs,
+ * i.e., the outputs [0, k) are the merge of a[0, i) and b[0, k - i). binary search along the merge path.
+ */
+template<typename ItA, typename ItB, typename Compare>
+std::size_t merge_split(ItA a, std::size_t na, ItB b, std::size_t nb, std::size_t k, Compare& comp)
+{
+    std::size_t lo = k > nb ? k - nb : 0;
+    std::size_t hi = std::min(k, na);
+    while(lo < hi)
+    {
+        const auto i = lo + (hi - lo) / 2;
+        const auto j = k - i;
+
+        // ties are taken from a first, so a[i] precedes b[j - 1] unless b[j - 1] is strictly smaller.
+        if(!comp(b[j - 1], a[i]))
+        {
+            lo = i + 1;
+        }
+        else
+        {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+/**
+ * merge neighbouring pairs of the sorted runs of src into dst, and update the run boundaries. every pair is split into
+ * pieces at merge path split points, so that all workers take part in the merge even when only a few runs are left.
+ * a run without a partner is moved.
+ */
+template<typename Pool, typename SrcIt, typename DstIt, typename Compare>
+void merge_runs(Pool& pool, SrcIt src, DstIt dst, std::vector<std::size_t>& runs, Compare& comp)
+{
+    /** a part of the merge of two runs. */
+    struct piece
+    {
+        std::size_t a_first, a_last;
+        std::size_t b_first, b_last;
+        std::size_t out;
+    };
+
+    const std::size_t run_count = runs.size() - 1;
+    const std::size_t group_count = (run_count + 1) / 2;
+    const std::size_t workers = std::max<std::size_t>(pool.get_thread_count(), 1);
+    const std::size_t pieces_per_group = (workers + group_count - 1) / group_count;
+
+    std::vector<piece> pieces;
+    pieces.reserve(group_count * pieces_per_group);
+
+    std::vector<std::size_t> merged_runs;
+    merged_runs.reserve(group_count + 1);
+
+    for(std::size_t r = 0; r < run_count; r += 2)
+    {
+        const auto a_first = runs[r];
+        const auto b_first = runs[r + 1];
+        const auto b_last = r + 2 <= run_count ? runs[r + 2] : b_first;
+        const auto na = b_first - a_first;
+        const auto nb = b_last - b_first;
+
+        std::size_t prev_i = 0;
+        std::size_t prev_k = 0;
+        for(std::size_t s = 1; s <= pieces_per_group; ++s)
+        {
+            const auto k = (na + nb) * s / pieces_per_group;
+            const auto i = s == pieces_per_group ? na : merge_split(src + a_first, na, src + b_first, nb, k, comp);
+
+            pieces.push_back({a_first + prev_i, a_first + i, b_first + (prev_k - prev_i), b_first + (k - i), a_first + prev_k});
+            prev_i = i;
+            prev_k = k;
+        }
+
+        merged_runs.push_back(a_first);
+    }
+    merged_runs.push_back(runs.back());
+
+    auto merge_piece = [&pieces, &src, &dst, &comp](std::size_t p)
+    {
+        auto& it = pieces[p];
+        std::merge(std::make_move_iterator(src + it.a_first), std::make_move_iterator(src + it.a_last),
+                   std::make_move_iterator(src + it.b_first), std::make_move_iterator(src + it.b_last),
+                   dst + it.out, comp);
+    };
+    run_blocks(pool, pieces.size(), merge_piece);
+
+    runs = std::move(merged_runs);
+}
+
+/**
+ * return acc reduced with transform(x) for all x in [first, last), in order. groups of four elements are reduced pairwise
+ * before they are added to acc, which needs reduce to be associative only, and shortens the dependency chain through acc.
+ */
+template<typename T, typename R, typename Reduce, typename Transform>
+R transform_reduce_block(const T* first, const T* last, R acc, Reduce& reduce, Transform& transform)
+{
+    for(; last - first >= 4; first += 4)
+    {
+        acc = reduce(std::move(acc), reduce(reduce(transform(first[0]), transform(first[1])), reduce(transform(first[2]), transform(first[3]))));
+    }
+    for(; first != last; ++first)
+    {
+        acc = reduce(std::move(acc), transform(*first));
+    }
+    return acc;
+}
+
+} /* namespace detail */
+
+/**
+ * sort [first, last) with comp. the range is split into one block per worker, the blocks are sorted with std::sort, and
+ * the sorted runs are merged pairwise through a buffer of the same size, where every merge round is split over all workers.
+ * as std::sort, this is not stable. the element type has to be default constructible and movable.
+ *
+ * as parallel_for, this runs (and waits for) the pool's whole task queue. small ranges are sorted by the calling thread.
+ */
+template<typename Pool, typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(Pool& pool, RandomIt first, RandomIt last, Compare comp = Compare{})
+{
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    const std::size_t length = static_cast<std::size_t>(std::distance(first, last));
+    const auto blocks = detail::block_count<value_type>(length, pool.get_thread_count());
+    if(blocks < 2)
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    std::vector<std::size_t> runs(blocks + 1);
+    for(std::size_t b = 0; b <= blocks; ++b)
+    {
+        runs[b] = length * b / blocks;
+    }
+
+    auto sort_block = [&runs, &first, &comp](std::size_t b)
+    {
+        std::sort(first + runs[b], first + runs[b + 1], comp);
+    };
+    detail::run_blocks(pool, blocks, sort_block);
+
+    // merge through the buffer, alternating the direction.
+    std::vector<value_type> buffer(length);
+    bool in_buffer = false;
+    while(runs.size() > 2)
+    {
+        if(in_buffer)
+        {
+            detail::merge_runs(pool, buffer.begin(), first, runs, comp);
+        }
+        else
+        {
+            detail::merge_runs(pool, first, buffer.begin(), runs, comp);
+        }
+        in_buffer = !in_buffer;
+    }
+
+    if(in_buffer)
+    {
+        auto move_block = [&buffer, &first, length, blocks](std::size_t b)
+        {
+            std::move(buffer.begin() + length * b / blocks, buffer.begin() + length * (b + 1) / blocks, first + length * b / blocks);
+        };
+        detail::run_blocks(pool, blocks, move_block);
+    }
+}
+
+/**
+ * store the inclusive prefix sums of [first, last) under op to out, i.e. out[i] = in[0] op ... op in[i], and return
+ * the end of the output. op has to be associative.
+ *
+ * every worker gets one contiguous block, aligned to the output's cache lines (see parallel_transform). a first pass
+ * reduces all blocks but the last one, the block sums are scanned by the calling thread, and a second pass scans every
+ * block starting from the sum of the blocks before it. so the input is read twice and the output written once.
+ *
+ * the output may alias the input. as parallel_for, this runs (and waits for) the pool's whole task queue. small ranges
+ * are scanned by the calling thread.
+ */
+template<typename Pool, typename T, typename U, typename Op = std::plus<>>
+U* parallel_inclusive_scan(Pool& pool, const T* first, const T* last, U* out, Op op = Op{})
+{
+    const std::size_t length = static_cast<std::size_t>(last - first);
+    auto blocks = detail::make_aligned_blocks(length, detail::block_count<U>(length, pool.get_thread_count()), out);
+    if(blocks.size() < 2)
+    {
+        return std::inclusive_scan(first, last, out, op);
+    }
+
+    // sums of the blocks, and after the scan, of all blocks up to and including the block.
+    std::vector<detail::padded_value<U>> sums(blocks.size() - 1);
+
+    auto reduce_block = [&blocks, &sums, first, &op](std::size_t b)
+    {
+        auto [block_first, block_last] = blocks[b];
+        U acc = first[block_first];
+        for(auto i = block_first + 1; i < block_last; ++i)
+        {
+            acc = op(std::move(acc), first[i]);
+        }
+        sums[b].value = std::move(acc);
+    };
+    detail::run_blocks(pool, sums.size(), reduce_block);
+
+    for(std::size_t b = 1; b < sums.size(); ++b)
+    {
+        sums[b].value = op(sums[b - 1].value, sums[b].value);
+    }
+
+    auto scan_block = [&blocks, &sums, first, out, &op](std::size_t b)
+    {
+        auto [block_first, block_last] = blocks[b];
+        if(b == 0)
+        {
+            std::inclusive_scan(first + block_first, first + block_last, out + block_first, op);
+        }
+        else
+        {
+            std::inclusive_scan(first + block_first, first + block_last, out + block_first, op, sums[b - 1].value);
+        }
+    };
+    detail::run_blocks(pool, blocks.size(), scan_block);
+
+    return out + length;
+}
+
+/**
+ * return init reduced with transform(x) for all x in [first, last), i.e. reduce(init, transform(in[0])), ...
+ * reduce has to be associative, but need not be commutative: the range is split into a few chunks per worker, every
+ * chunk is reduced without init, and the partial results, stored in separate cache lines, are combined in order.
+ *
+ * as parallel_for, this runs (and waits for) the pool's whole task queue. small ranges are reduced by the calling thread.
+ */
+template<typename Pool, typename T, typename R, typename Reduce, typename Transform>
+R parallel_transform_reduce(Pool& pool, const T* first, const T* last, R init, Reduce reduce, Transform transform)
+{
+    const std::size_t length = static_cast<std::size_t>(last - first);
+    if(detail::block_count<T>(length, pool.get_thread_count()) < 2)
+    {
+        return detail::transform_reduce_block(first, last, std::move(init), reduce, transform);
+    }
+
+    auto chunks = detail::make_chunks<std::size_t>(0, length, detail::min_block_elements<T>(), pool.get_thread_count(), partition::static_chunks);
+    std::vector<detail::padded_value<R>> partials(chunks.size(), detail::padded_value<R>{init});
+
+    auto reduce_chunk = [&chunks, &partials, first, &reduce, &transform](std::size_t c)
+    {
+        auto [chunk_first, chunk_last] = chunks[c];
+        partials[c].value = detail::transform_reduce_block(first + chunk_first + 1, first + chunk_last, R(transform(first[chunk_first])), reduce, transform);
+    };
+    detail::run_blocks(pool, chunks.size(), reduce_chunk);
+
+    for(auto& it: partials)
+    {
+        init = reduce(std::move(init), std::move(it.value));
+    }
+    return init;
+}
+
+/**
+ * copy the elements of [first, last) for which pred returns true to out, keeping their order, and return the end of the
+ * output. a first pass evaluates pred once per element into a mask and counts the matches of every block, the calling
+ * thread computes the output offsets of the blocks, and a second pass copies the marked elements.
+ *
+ * the output must not overlap the input. as parallel_for, this runs (and waits for) the pool's whole task queue. small
+ * ranges are processed by the calling thread.
+ */
+template<typename Pool, typename T, typename U, typename Pred>
+U* parallel_copy_if(Pool& pool, const T* first, const T* last, U* out, Pred pred)
+{
+    const std::size_t length = static_cast<std::size_t>(last - first);
+    const auto count = detail::block_count<T>(length, pool.get_thread_count());
+    if(count < 2)
+    {
+        return std::copy_if(first, last, out, pred);
+    }
+
+    // the blocks are aligned to the mask's cache lines, so that the workers do not share a line of the mask.
+    std::vector<unsigned char> mask(length);
+    auto blocks = detail::make_aligned_blocks(length, count, mask.data());
+
+    // the number of matches of every block, and after the scan, the output offset of the block.
+    std::vector<detail::padded_value<std::size_t>> offsets(blocks.size(), detail::padded_value<std::size_t>{0});
+
+    auto mark_block = [&blocks, &mask, &offsets, first, &pred](std::size_t b)
+    {
+        auto [block_first, block_last] = blocks[b];
+        std::size_t matches = 0;
+        for(auto i = block_first; i < block_last; ++i)
+        {
+            const bool selected = pred(first[i]);
+            mask[i] = selected;
+            matches += selected;
+        }
+        offsets[b].value = matches;
+    };
+    detail::run_blocks(pool, blocks.size(), mark_block);
+
+    std::size_t total = 0;
+    for(auto& it: offsets)
+    {
+        auto matches = it.value;
+        it.value = total;
+        total += matches;
+    }
+
+    auto copy_block = [&blocks, &mask, &offsets, first, out](std::size_t b)
+    {
+        auto [block_first, block_last] = blocks[b];
+        auto block_out = out + offsets[b].value;
+        for(auto i = block_first; i < block_last; ++i)
+        {
+            if(mask[i])
+            {
+                *block_out++ = first[i];
+            }
+        }
+    };
+    detail::run_blocks(pool, blocks.size(), copy_block);
+
+    return out + total;
+}
+
+} /* namespace concurrency_utils */
@@ -0,0 +1,244 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * bump-pointer arenas for short-lived allocations. every worker of a deferred_thread_pool owns an arena, which is reset
+ * at the end of every run, so that tasks can allocate temporaries without going through the global allocator.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace concurrency_utils
+{
+
+/**
+ * a bump-pointer arena. allocations are taken from large blocks and never freed individually; reset() makes all
+ * memory available again, but keeps the blocks, so an arena which reached its working size does not allocate anymore.
+ *
+ * objects placed in an arena are not destroyed by the arena. an arena must only be used by one thread at a time.
+ */
+class arena
+{
+    /** a block of memory. */
+    struct block
+    {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size{0};
+    };
+
+    /** the blocks. blocks before the current one are used up. */
+    std::vector<block> blocks;
+
+    /** the block allocations are taken from. */
+    std::size_t current{0};
+
+    /** next free byte in the current block. */
+    std::size_t offset{0};
+
+    /** size of newly allocated blocks. */
+    std::size_t block_size;
+
+    /** bytes handed out since the last reset. */
+    std::size_t used_bytes{0};
+
+    /** try to take memory from the current block. */
+    void* try_allocate(std::size_t size, std::size_t alignment)
+    {
+        if(current >= blocks.size())
+        {
+            return nullptr;
+        }
+
+        auto& b = blocks[current];
+        auto address = reinterpret_cast<std::uintptr_t>(b.data.get()) + offset;
+        auto aligned = (address + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+        auto end = aligned - reinterpret_cast<std::uintptr_t>(b.data.get()) + size;
+        if(end > b.size)
+        {
+            return nullptr;
+        }
+
+        offset = end;
+        used_bytes += size;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+public:
+    /** default size of a block. */
+    static constexpr std::size_t default_block_size = 64 * 1024;
+
+    /** constructor. no memory is allocated before the first allocation. */
+    explicit arena(std::size_t in_block_size = default_block_size)
+    : block_size{std::max<std::size_t>(in_block_size, 64)}
+    {
+    }
+
+    /** disable copying. */
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    /** allocate memory. the alignment has to be a power of two. */
+    void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+    {
+        if(auto p = try_allocate(size, alignment))
+        {
+            return p;
+        }
+
+        // move on to the next block which is large enough, or append a new one.
+        const auto required = size + alignment;
+        while(++current < blocks.size())
+        {
+            offset = 0;
+            if(blocks[current].size >= required)
+            {
+                return try_allocate(size, alignment);
+            }
+        }
+
+        const auto new_size = std::max(block_size, required);
+        blocks.push_back({std::make_unique<unsigned char[]>(new_size), new_size});
+        current = blocks.size() - 1;
+        offset = 0;
+        return try_allocate(size, alignment);
+    }
+
+    /** allocate uninitialized storage for count objects of type T. */
+    template<typename T>
+    T* allocate_array(std::size_t count)
+    {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /** make all memory available again. the blocks are kept. */
+    void reset()
+    {
+        current = 0;
+        offset = 0;
+        used_bytes = 0;
+    }
+
+    /** free all blocks. */
+    void release()
+    {
+        blocks.clear();
+        reset();
+    }
+
+    /** return the number of bytes allocated since the last reset, without alignment padding. */
+    std::size_t get_used_bytes() const
+    {
+        return used_bytes;
+    }
+
+    /** return the number of bytes held by the arena's blocks. */
+    std::size_t get_capacity() const
+    {
+        std::size_t total = 0;
+        for(auto& it: blocks)
+        {
+            total += it.size;
+        }
+        return total;
+    }
+};
+
+/** a standard allocator taking memory from an arena, e.g. for std::vector<T, arena_allocator<T>>. deallocation does nothing. */
+template<typename T>
+class arena_allocator
+{
+    template<typename U>
+    friend class arena_allocator;
+
+    /** the arena. */
+    arena* source;
+
+public:
+    using value_type = T;
+
+    /** constructor. */
+    explicit arena_allocator(arena& in_source) noexcept
+    : source{&in_source}
+    {
+    }
+
+    /** conversion from allocators of other types. */
+    template<typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept
+    : source{other.source}
+    {
+    }
+
+    /** allocate storage for n objects. */
+    T* allocate(std::size_t n)
+    {
+        return source->allocate_array<T>(n);
+    }
+
+    /** memory is returned by resetting the arena. */
+    void deallocate(T*, std::size_t) noexcept
+    {
+    }
+
+    /** allocators are equal if they use the same arena. */
+    template<typename U>
+    bool operator==(const arena_allocator<U>& other) const noexcept
+    {
+        return source == other.source;
+    }
+
+    template<typename U>
+    bool operator!=(const arena_allocator<U>& other) const noexcept
+    {
+        return source != other.source;
+    }
+};
+
+namespace detail
+{
+
+/** the arena of the pool worker running on this thread, or nullptr if the thread is not a worker. set by the pool. */
+inline thread_local arena* current_arena = nullptr;
+
+/** return the arena of a thread which is not a pool worker. */
+inline arena& thread_arena()
+{
+    static thread_local arena local;
+    return local;
+}
+
+} /* namespace detail */
+
+namespace this_worker
+{
+
+/**
+ * return the arena of the calling thread. inside a task of a deferred_thread_pool, this is the worker's arena, which is
+ * reset at the end of the run. memory allocated from it must not be used after the run.
+ *
+ * other threads get their own arena, which is reset at the end of every run_tasks_and_wait they call (i.e., the
+ * arena of the thread which pushes the tasks lives as long as the tasks of a run, see arena_task).
+ */
+inline concurrency_utils::arena& arena()
+{
+    if(auto a = detail::current_arena)
+    {
+        return *a;
+    }
+    return detail::thread_arena();
+}
+
+} /* namespace this_worker */
+
+} /* namespace concurrency_utils */
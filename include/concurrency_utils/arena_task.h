@@ -0,0 +1,169 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * a move-only task type that stores small callables inline and larger callables in the arena of the thread constructing
+ * the task, i.e., that does not use the global allocator.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "arena.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * a move-only replacement for std::function<void()>. callables which fit into the buffer are stored inline, as in
+ * inplace_task. larger callables are placed in this_worker::arena() of the thread constructing the task, which only
+ * stores a pointer. the arena memory is reclaimed when the arena is reset, i.e., at the end of the pool's run.
+ *
+ * so the tasks of a run have to be pushed and run before the pushing thread's arena is reset, which is the case for the
+ * push_task / run_tasks_and_wait cycle of a deferred_thread_pool, and for tasks pushed from its workers. tasks which are
+ * kept across runs (e.g. in a task_batch) or pushed into a continuous_thread_pool should use inplace_task or std::function.
+ */
+template<std::size_t capacity = 64, std::size_t alignment = alignof(std::max_align_t)>
+class arena_task
+{
+    static_assert(capacity >= sizeof(void*), "arena_task: the buffer needs to hold at least a pointer.");
+
+    /** operations on the stored callable. */
+    struct operations
+    {
+        /** invoke the callable. */
+        void (*invoke)(void*);
+
+        /** move the callable into uninitialized storage and destroy the source. */
+        void (*relocate)(void* dst, void* src);
+
+        /** destroy the callable. */
+        void (*destroy)(void*);
+    };
+
+    /** operations for a callable stored inline. */
+    template<typename F>
+    static constexpr operations inline_operations = {
+      [](void* f)
+      { std::invoke(*static_cast<F*>(f)); },
+      [](void* dst, void* src)
+      {
+          ::new(dst) F(std::move(*static_cast<F*>(src)));
+          static_cast<F*>(src)->~F();
+      },
+      [](void* f)
+      { static_cast<F*>(f)->~F(); }};
+
+    /** operations for a callable stored in an arena. the buffer holds a pointer to the callable, which is not moved. */
+    template<typename F>
+    static constexpr operations arena_operations = {
+      [](void* f)
+      { std::invoke(**static_cast<F**>(f)); },
+      [](void* dst, void* src)
+      { *static_cast<F**>(dst) = *static_cast<F**>(src); },
+      [](void* f)
+      { (*static_cast<F**>(f))->~F(); }};
+
+    /** storage for the callable, or for a pointer to it. */
+    alignas(alignment) unsigned char storage[capacity];
+
+    /** operations of the stored callable. nullptr if the task is empty. */
+    const operations* ops{nullptr};
+
+public:
+    /** default constructor creates an empty task. */
+    arena_task() = default;
+
+    /** construct the task from a callable. */
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, arena_task>>>
+    arena_task(F&& f)
+    {
+        using callable = std::decay_t<F>;
+
+        static_assert(std::is_invocable_v<callable&>, "arena_task: the callable needs to be invocable without arguments.");
+
+        if constexpr(sizeof(callable) <= capacity && alignof(callable) <= alignment && std::is_nothrow_move_constructible_v<callable>)
+        {
+            ::new(storage) callable(std::forward<F>(f));
+            ops = &inline_operations<callable>;
+        }
+        else
+        {
+            auto p = this_worker::arena().allocate(sizeof(callable), alignof(callable));
+            *reinterpret_cast<callable**>(storage) = ::new(p) callable(std::forward<F>(f));
+            ops = &arena_operations<callable>;
+        }
+    }
+
+    /** move constructor. */
+    arena_task(arena_task&& other) noexcept
+    : ops{other.ops}
+    {
+        if(ops)
+        {
+            ops->relocate(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+
+    /** move assignment. */
+    arena_task& operator=(arena_task&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+
+            if(other.ops)
+            {
+                other.ops->relocate(storage, other.storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
+        }
+
+        return *this;
+    }
+
+    /** tasks are move-only. */
+    arena_task(const arena_task&) = delete;
+    arena_task& operator=(const arena_task&) = delete;
+
+    /** destructor. */
+    ~arena_task()
+    {
+        reset();
+    }
+
+    /** destroy the stored callable. arena memory is not returned before the arena is reset. */
+    void reset()
+    {
+        if(ops)
+        {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    /** invoke the stored callable. the task must not be empty. */
+    void operator()()
+    {
+        ops->invoke(storage);
+    }
+
+    /** check whether the task holds a callable. */
+    explicit operator bool() const
+    {
+        return ops != nullptr;
+    }
+};
+
+} /* namespace concurrency_utils */
@@ -0,0 +1,112 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * cooperative cancellation. a cancellation_source hands out tokens, which are attached to tasks or polled by
+ * long-running tasks. cancelling the source cancels all its tokens.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace concurrency_utils
+{
+
+/** a read-only view of a cancellation_source's state. cheap to copy. a default-constructed token is never cancelled. */
+class cancellation_token
+{
+    friend class cancellation_source;
+
+    /** the shared cancellation flag, or nullptr. */
+    std::shared_ptr<const std::atomic_bool> state;
+
+    /** constructor used by cancellation_source. */
+    explicit cancellation_token(std::shared_ptr<const std::atomic_bool> in_state)
+    : state{std::move(in_state)}
+    {
+    }
+
+public:
+    /** default constructor creates a token which cannot be cancelled. */
+    cancellation_token() = default;
+
+    /** check whether cancellation was requested. a single relaxed load, so it can be polled inside tight loops. */
+    bool is_cancelled() const
+    {
+        return state && state->load(std::memory_order_relaxed);
+    }
+
+    /** check whether the token is associated with a source. */
+    bool can_be_cancelled() const
+    {
+        return state != nullptr;
+    }
+};
+
+/** owner of a cancellation flag. the flag lives as long as the source or any of its tokens. */
+class cancellation_source
+{
+    /** the shared cancellation flag. */
+    std::shared_ptr<std::atomic_bool> state{std::make_shared<std::atomic_bool>(false)};
+
+public:
+    /** return a token observing this source. */
+    cancellation_token token() const
+    {
+        return cancellation_token{state};
+    }
+
+    /** request cancellation. tasks that did not start yet are skipped, running tasks see it through their tokens. thread-safe. */
+    void cancel()
+    {
+        state->store(true, std::memory_order_relaxed);
+    }
+
+    /** check whether cancellation was requested. */
+    bool is_cancelled() const
+    {
+        return state->load(std::memory_order_relaxed);
+    }
+
+    /** replace the flag by a fresh one, e.g. for the next frame. tokens handed out before stay cancelled. */
+    void reset()
+    {
+        state = std::make_shared<std::atomic_bool>(false);
+    }
+};
+
+namespace detail
+{
+
+/** check whether a type is a cancellation token, so that push_task(token, f) is not mistaken for binding arguments. */
+template<typename T>
+constexpr bool is_cancellation_token = std::is_same_v<std::decay_t<T>, cancellation_token>;
+
+/** wrap a task so that it is skipped if the token was cancelled before the task started. skipped tasks are counted, if a counter is given. */
+template<typename F>
+auto make_cancellable_task(cancellation_token token, F&& f, std::atomic_size_t* skipped = nullptr)
+{
+    return [token = std::move(token), f = std::forward<F>(f), skipped]() mutable
+    {
+        if(!token.is_cancelled())
+        {
+            f();
+        }
+        else if(skipped)
+        {
+            skipped->fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+}
+
+} /* namespace detail */
+
+} /* namespace concurrency_utils */
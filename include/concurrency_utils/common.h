@@ -0,0 +1,95 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * common definitions shared by the queues and the thread pool.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+
+#ifndef CONCURRENCY_UTILS_CACHE_LINE_SIZE
+#    define CONCURRENCY_UTILS_CACHE_LINE_SIZE 64
+#endif
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#    if __has_include(<coroutine>)
+#        define CONCURRENCY_UTILS_HAS_COROUTINES
+#    endif
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    include <immintrin.h>
+#    define CONCURRENCY_UTILS_HAS_MM_PAUSE
+#endif
+
+namespace concurrency_utils
+{
+
+/**
+ * assumed cache line size. used to separate data written by different threads. can be overridden by defining
+ * CONCURRENCY_UTILS_CACHE_LINE_SIZE, e.g. to 128 on CPUs that prefetch cache lines in pairs.
+ *
+ * std::hardware_destructive_interference_size is not used, since its value may change with compiler flags,
+ * which would change the class layout between translation units.
+ */
+constexpr std::size_t cache_line_size = CONCURRENCY_UTILS_CACHE_LINE_SIZE;
+
+/** hint to the processor that we are inside a spin-wait loop. falls back to yielding the thread on unknown architectures. */
+inline void cpu_pause()
+{
+#if defined(CONCURRENCY_UTILS_HAS_MM_PAUSE)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+namespace detail
+{
+
+/** check whether a queue allows pushing while consumers pop, i.e., whether it declares concurrent_push_pop = true. */
+template<typename queue_type, typename = void>
+struct is_concurrent_queue : std::false_type
+{
+};
+
+template<typename queue_type>
+struct is_concurrent_queue<queue_type, std::enable_if_t<queue_type::concurrent_push_pop>> : std::true_type
+{
+};
+
+/** check whether a queue has a fixed capacity, i.e., whether it declares bounded = true. */
+template<typename queue_type, typename = void>
+struct is_bounded_queue : std::false_type
+{
+};
+
+template<typename queue_type>
+struct is_bounded_queue<queue_type, std::enable_if_t<queue_type::bounded>> : std::true_type
+{
+};
+
+/** check whether a queue only allows one consumer at a time, i.e., whether it declares single_consumer = true. */
+template<typename queue_type, typename = void>
+struct is_single_consumer_queue : std::false_type
+{
+};
+
+template<typename queue_type>
+struct is_single_consumer_queue<queue_type, std::enable_if_t<queue_type::single_consumer>> : std::true_type
+{
+};
+
+} /* namespace detail */
+
+} /* namespace concurrency_utils */
@@ -0,0 +1,575 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * a thread pool whose workers pick up tasks as soon as they are pushed.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+#include "thread_pool.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * a thread pool which processes tasks continuously, i.e., without start_tasks() or run_tasks_and_wait(). tasks can be
+ * pushed from any thread at any time, including from running tasks.
+ *
+ * queues which allow concurrent pushes and pops (see queue_traits::is_multi_producer, e.g. mpmc_blocking_queue and
+ * mpmc_bounded_queue) are used directly. all other queues are protected by a mutex, which makes them safe,
+ * but serializes all queue operations.
+ *
+ * idle workers spin for a short while and then park on a condition variable. pushes only touch the condition
+ * variable if a worker is parked.
+ */
+template<typename queue_type = mpmc_blocking_queue<std::function<void()>>, typename wait_policy = backoff_wait<>>
+class continuous_thread_pool
+{
+public:
+    /** task type. */
+    using task_type = typename queue_type::value_type;
+
+    /** properties of the queue. */
+    using traits = queue_traits<queue_type>;
+
+    static_assert(detail::is_pool_queue<queue_type>::value, "continuous_thread_pool: the queue needs value_type, emplace, try_pop, empty, size and clear (see queue_traits.h).");
+    static_assert(traits::is_multi_consumer, "continuous_thread_pool: the queue needs to support multiple consumers.");
+
+    /** number of times an idle worker checks for new tasks before it parks. */
+    static constexpr std::size_t idle_spin_count = 1024;
+
+private:
+    /** whether the queue can be used without additional locking. */
+    static constexpr bool lock_free_access = traits::is_multi_producer;
+
+    /*
+     * read-mostly data. only written when creating or destroying the pool.
+     */
+
+    /** thread count. */
+    std::size_t thread_count{0};
+
+    /** placement of the workers. */
+    detail::pool_placement placement;
+
+    /** threads. */
+    std::vector<std::thread> threads;
+
+    /** number of tasks a worker claims from the queue at once. 0 selects the number adaptively. */
+    std::atomic_size_t chunk_size{0};
+
+    /** upper bound for adaptively selected chunk sizes. */
+    static constexpr std::size_t max_adaptive_chunk_size = 32;
+
+    /*
+     * data written by different threads. every member starts on its own cache line.
+     */
+
+    /** An atomic variable indicating to the workers to stop. */
+    alignas(cache_line_size) std::atomic_bool stop{false};
+
+    /** whether the first exception cancels the tasks pushed before the next wait_idle. */
+    std::atomic_bool cancel_on_error{false};
+
+    /** set if a task failed and cancel_on_error is set. popped tasks are skipped until the next wait_idle. */
+    std::atomic_bool cancelled{false};
+
+    /** shared states for futures returned by submit. declared before the task queue, since queued tasks may still reference states. */
+    alignas(cache_line_size) detail::block_pool future_states;
+
+    /** task queue. */
+    alignas(cache_line_size) queue_type tasks;
+
+    /** protects the queue, if it does not support concurrent pushes and pops. */
+    alignas(cache_line_size) std::mutex queue_mutex;
+
+    /** number of pushed tasks which were not popped yet. incremented before a task is pushed, so that parking workers do not miss it. */
+    alignas(cache_line_size) std::atomic_size_t queued_tasks{0};
+
+    /** number of pushed tasks which did not finish yet. */
+    alignas(cache_line_size) std::atomic_size_t pending_tasks{0};
+
+    /** mutex for parking idle workers. */
+    alignas(cache_line_size) std::mutex park_mutex;
+
+    /** condition variable for parked workers. */
+    std::condition_variable wake_up;
+
+    /** number of parked workers. */
+    std::atomic_size_t parked_workers{0};
+
+    /** waits for the pending tasks to finish. notified by the last finished task. */
+    alignas(cache_line_size) wait_policy completion;
+
+    /** protects errors. */
+    alignas(cache_line_size) std::mutex error_mutex;
+
+    /** exceptions thrown by tasks since the last wait_idle. */
+    std::vector<std::exception_ptr> errors;
+
+    /*
+     * private helpers.
+     */
+
+    /** run an operation on the queue, holding the queue lock if necessary. */
+    template<typename Op>
+    decltype(auto) access_queue(Op&& op)
+    {
+        if constexpr(lock_free_access)
+        {
+            return op(tasks);
+        }
+        else
+        {
+            std::unique_lock lock{queue_mutex};
+            return op(tasks);
+        }
+    }
+
+    /** wake up parked workers after pushing the given number of tasks. */
+    void notify_workers(std::size_t count)
+    {
+        // queued_tasks was incremented before, so either a parking worker sees the new tasks, or we see the worker.
+        if(parked_workers.load() == 0)
+        {
+            return;
+        }
+
+        // acquire the mutex once, so that a worker which just checked for tasks is parked before we notify.
+        {
+            std::unique_lock lock{park_mutex};
+        }
+
+        if(count == 1)
+        {
+            wake_up.notify_one();
+        }
+        else
+        {
+            wake_up.notify_all();
+        }
+    }
+
+    /** return the number of tasks a worker should claim at once. */
+    std::size_t get_claim_size() const
+    {
+        auto n = chunk_size.load();
+        if(n)
+        {
+            return n;
+        }
+
+        // claim a fraction of the queued tasks, so that the other workers still find work.
+        return std::clamp<std::size_t>(queued_tasks.load(std::memory_order_relaxed) / (4 * thread_count), 1, max_adaptive_chunk_size);
+    }
+
+    /** pop up to max_n tasks off a queue on behalf of the worker with the given index. returns the number of popped tasks. */
+    static std::size_t pop_tasks(queue_type& queue, std::vector<task_type>& batch, std::size_t worker_index, std::size_t max_n)
+    {
+        if constexpr(traits::supports_bulk_pop)
+        {
+            if constexpr(traits::has_consumer_index)
+            {
+                return queue.try_pop_bulk(std::back_inserter(batch), max_n, worker_index);
+            }
+            else
+            {
+                return queue.try_pop_bulk(std::back_inserter(batch), max_n);
+            }
+        }
+        else
+        {
+            task_type task;
+            bool popped;
+            if constexpr(traits::has_consumer_index)
+            {
+                popped = queue.try_pop(task, worker_index);
+            }
+            else
+            {
+                popped = queue.try_pop(task);
+            }
+
+            if(popped)
+            {
+                batch.emplace_back(std::move(task));
+                return 1;
+            }
+
+            return 0;
+        }
+    }
+
+    /** pop tasks on behalf of the worker with the given index. returns the number of popped tasks. */
+    std::size_t pop_tasks(std::vector<task_type>& batch, std::size_t worker_index)
+    {
+        const auto max_n = get_claim_size();
+        return access_queue([&batch, worker_index, max_n](queue_type& queue) -> std::size_t
+                            {
+                                auto count = pop_tasks(queue, batch, worker_index, max_n);
+
+                                // queues without concurrent access (e.g. spmc_queue) keep their storage until they are cleared.
+                                // we hold the queue lock, so reset them once they are drained.
+                                if constexpr(!lock_free_access)
+                                {
+                                    if(count == 0)
+                                    {
+                                        queue.clear();
+                                    }
+                                }
+
+                                return count;
+                            });
+    }
+
+    /** wait for tasks. spins for a while and then parks the worker. returns false if the pool is stopped. */
+    bool wait_for_tasks()
+    {
+        for(std::size_t i = 0; i < idle_spin_count; ++i)
+        {
+            if(stop)
+            {
+                return false;
+            }
+
+            if(queued_tasks.load() > 0)
+            {
+                return true;
+            }
+
+            cpu_pause();
+        }
+
+        std::unique_lock lock{park_mutex};
+
+        // the increment needs to be visible before we check for tasks, so that notify_workers sees it.
+        ++parked_workers;
+        wake_up.wait(lock, [this]() -> bool
+                     { return stop || queued_tasks.load() > 0; });
+        --parked_workers;
+
+        return !stop;
+    }
+
+    /** run a task and store its exception. */
+    void invoke_task(task_type& task) noexcept
+    {
+        try
+        {
+            task();
+        }
+        catch(...)
+        {
+            {
+                std::unique_lock lock{error_mutex};
+                errors.emplace_back(std::current_exception());
+            }
+
+            if(cancel_on_error.load(std::memory_order_relaxed))
+            {
+                cancelled.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** wait until no task is pending. */
+    void wait_for_pending_tasks()
+    {
+        completion.wait([this]() -> bool
+                        { return pending_tasks == 0; });
+    }
+
+    /** worker function. */
+    void worker(std::size_t worker_index)
+    {
+        pin_this_thread(placement.workers[worker_index].cpus);
+
+        // tasks claimed from the queue. keeps its capacity.
+        std::vector<task_type> batch;
+
+        while(true)
+        {
+            if(auto count = pop_tasks(batch, worker_index); count > 0)
+            {
+                queued_tasks.fetch_sub(count);
+
+                for(auto& task: batch)
+                {
+                    if(!cancelled.load(std::memory_order_relaxed))
+                    {
+                        invoke_task(task);
+                    }
+                }
+                batch.clear();
+
+                // the last task wakes up threads waiting for the pool to become idle.
+                if(pending_tasks.fetch_sub(count) == count)
+                {
+                    completion.notify();
+                }
+            }
+            else if(!wait_for_tasks())
+            {
+                break;
+            }
+        }
+    }
+
+    /** create the worker threads. */
+    void create_threads(const pool_config& config)
+    {
+        auto worker_config = config;
+        worker_config.queue_per_node = false;
+
+        placement = detail::make_placement(worker_config);
+        thread_count = placement.workers.size();
+
+        if constexpr(traits::has_consumer_index)
+        {
+            tasks.set_consumer_count(thread_count);
+        }
+
+        threads.reserve(thread_count);
+        for(std::size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back(&continuous_thread_pool::worker, this, i);
+        }
+    }
+
+    /** finish all tasks and destroy the threads. */
+    void destroy_threads()
+    {
+        if(threads.size())
+        {
+            wait_for_pending_tasks();
+
+            {
+                std::unique_lock lock{park_mutex};
+                stop = true;
+            }
+            wake_up.notify_all();
+
+            for(auto& it: threads)
+            {
+                it.join();
+            }
+            threads.clear();
+        }
+
+        std::unique_lock lock{error_mutex};
+        errors.clear();
+    }
+
+public:
+    /** constructor. creates at least one thread. additional arguments are passed to the queue's constructor. */
+    template<typename... Args>
+    explicit continuous_thread_pool(std::size_t in_thread_count, Args&&... queue_args)
+    : continuous_thread_pool{pool_config{in_thread_count}, std::forward<Args>(queue_args)...}
+    {
+    }
+
+    /** create the threads according to a configuration. the pool uses a single queue, i.e., queue_per_node is ignored. */
+    template<typename... Args>
+    explicit continuous_thread_pool(const pool_config& config, Args&&... queue_args)
+    : tasks{std::forward<Args>(queue_args)...}
+    {
+        create_threads(config);
+    }
+
+    /** destructor. finishes all pushed tasks. */
+    ~continuous_thread_pool()
+    {
+        destroy_threads();
+    }
+
+    /** disable copying. */
+    continuous_thread_pool(const continuous_thread_pool&) = delete;
+    continuous_thread_pool& operator=(const continuous_thread_pool&) = delete;
+
+    /**
+     * wait until no task is pending. intake continues during the wait: tasks pushed concurrently (or by running tasks) are
+     * waited for as well, and the call returns the first time the pool is observed idle.
+     *
+     * if tasks threw since the last call, a task_errors holding their exceptions is thrown, and the cancellation
+     * (see set_cancel_on_error) is lifted.
+     */
+    void wait_idle()
+    {
+        wait_for_pending_tasks();
+
+        std::vector<std::exception_ptr> failed;
+        {
+            std::unique_lock lock{error_mutex};
+            failed.swap(errors);
+            cancelled = false;
+        }
+
+        if(!failed.empty())
+        {
+            throw task_errors{std::move(failed)};
+        }
+    }
+
+    /** set whether the first exception cancels the remaining tasks, i.e., whether popped tasks are skipped until the next wait_idle. */
+    void set_cancel_on_error(bool cancel)
+    {
+        cancel_on_error = cancel;
+    }
+
+    /** return whether the first exception cancels the remaining tasks. */
+    bool get_cancel_on_error() const
+    {
+        return cancel_on_error;
+    }
+
+    /** finish all tasks and stop the threads. no tasks may be pushed afterwards. */
+    void wait_and_exit()
+    {
+        destroy_threads();
+    }
+
+    /** push a function with no arguments or return value. the task is picked up immediately. thread-safe. */
+    template<typename F>
+    void push_task(F&& task)
+    {
+        // the task has to be counted before it can be popped.
+        ++pending_tasks;
+        ++queued_tasks;
+        access_queue([&task](queue_type& queue)
+                     { queue.emplace(std::forward<F>(task)); });
+
+        notify_workers(1);
+    }
+
+    /** push a function with arguments, but no return value. the arguments are forwarded into the task. thread-safe. */
+    template<typename F, typename... A, typename = std::enable_if_t<!detail::is_cancellation_token<F>>>
+    void push_task(F&& task, A&&... args)
+    {
+        push_task(detail::bind_task(std::forward<F>(task), std::forward<A>(args)...));
+    }
+
+    /** push a function with no arguments or return value, which is skipped if the token is cancelled before the task starts. thread-safe. */
+    template<typename F>
+    void push_task(cancellation_token token, F&& task)
+    {
+        push_task(detail::make_cancellable_task(std::move(token), std::forward<F>(task)));
+    }
+
+    /** push a function with no arguments or return value into the lane of the given priority. requires a queue with priorities, e.g. priority_lane_queue. thread-safe. */
+    template<typename F>
+    void push_priority_task(std::size_t priority, F&& task)
+    {
+        static_assert(traits::has_priorities, "push_priority_task: the queue does not support priorities. use priority_lane_queue.");
+
+        ++pending_tasks;
+        ++queued_tasks;
+        access_queue([priority, &task](queue_type& queue)
+                     { queue.emplace_with_priority(priority, std::forward<F>(task)); });
+
+        notify_workers(1);
+    }
+
+    /** push a range of functions with no arguments or return value. thread-safe. */
+    template<typename R>
+    void push_tasks(R&& range)
+    {
+        auto first = std::begin(range);
+        auto last = std::end(range);
+
+        const std::size_t count = std::distance(first, last);
+        if(count == 0)
+        {
+            return;
+        }
+
+        pending_tasks += count;
+        queued_tasks += count;
+        access_queue([first, last](queue_type& queue)
+                     {
+                         if constexpr(traits::supports_bulk_push)
+                         {
+                             queue.push_bulk(first, last);
+                         }
+                         else
+                         {
+                             for(auto it = first; it != last; ++it)
+                             {
+                                 queue.emplace(*it);
+                             }
+                         }
+                     });
+
+        notify_workers(count);
+    }
+
+    /** push a function with arguments and return a future for its result. thread-safe. */
+    template<typename F, typename... A>
+    auto submit(F&& task, A&&... args) -> future<std::invoke_result_t<std::decay_t<F>&, std::decay_t<A>&...>>
+    {
+        using result_type = std::invoke_result_t<std::decay_t<F>&, std::decay_t<A>&...>;
+        static_assert(!std::is_reference_v<result_type>, "submit: tasks returning references are not supported. return a pointer or a std::reference_wrapper instead.");
+
+        auto state = detail::future_state<result_type>::create(future_states);
+        push_task([p = detail::promise<result_type>{state}, f = detail::bind_task(std::forward<F>(task), std::forward<A>(args)...)]() mutable
+                  { p.run(f); });
+
+        return future<result_type>{state};
+    }
+
+#if defined(CONCURRENCY_UTILS_HAS_COROUTINES)
+    /** push a coroutine handle. the handle itself is stored as the task, so resuming does not allocate. thread-safe. */
+    void push_coroutine(std::coroutine_handle<> handle)
+    {
+        push_task(handle);
+    }
+
+    /** return an awaitable which resumes the awaiting coroutine on one of the pool's workers, i.e., co_await pool.schedule(). */
+    detail::schedule_awaiter<continuous_thread_pool> schedule()
+    {
+        return detail::schedule_awaiter<continuous_thread_pool>{*this};
+    }
+#endif
+
+    /** set the number of tasks a worker claims from the queue at once. 0 (the default) adapts the number to the queue length. */
+    void set_chunk_size(std::size_t n)
+    {
+        chunk_size = n;
+    }
+
+    /** return the number of tasks a worker claims from the queue at once. 0 means the number is selected adaptively. */
+    std::size_t get_chunk_size() const
+    {
+        return chunk_size;
+    }
+
+    /** return the number of threads. */
+    std::size_t get_thread_count() const
+    {
+        return thread_count;
+    }
+
+    /** return the number of tasks which were pushed but did not finish yet. */
+    std::size_t get_pending_tasks() const
+    {
+        return pending_tasks;
+    }
+};
+
+} /* namespace concurrency_utils */
@@ -0,0 +1,401 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * C++20 coroutine support: a lazy task<T>, an awaitable for resuming on a thread pool, and sync_wait.
+ * everything in this file is only available if the compiler supports coroutines.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include "common.h"
+
+#if defined(CONCURRENCY_UTILS_HAS_COROUTINES)
+
+#    include <condition_variable>
+#    include <coroutine>
+#    include <exception>
+#    include <mutex>
+#    include <optional>
+#    include <type_traits>
+#    include <utility>
+
+namespace concurrency_utils
+{
+
+template<typename T = void>
+class task;
+
+namespace detail
+{
+
+/**
+ * awaitable returned by schedule(). suspends the coroutine and pushes its handle into the pool, so that it is resumed
+ * by a worker. the handle is stored directly as the pool's task, i.e., without an additional closure.
+ */
+template<typename Pool>
+class schedule_awaiter
+{
+    /** the pool to resume on. */
+    Pool& pool;
+
+public:
+    /** constructor. */
+    explicit schedule_awaiter(Pool& in_pool)
+    : pool{in_pool}
+    {
+    }
+
+    /** always suspend. */
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    /** hand the coroutine to the pool. */
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        pool.push_coroutine(handle);
+    }
+
+    /** nothing to return. */
+    void await_resume() const noexcept
+    {
+    }
+};
+
+/** promise data shared by all task<T>. */
+class task_promise_base
+{
+    /** resumes the awaiting coroutine when the task finished. */
+    struct final_awaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        /** symmetric transfer to the continuation, so that chains of tasks do not grow the stack. */
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            return handle.promise().continuation;
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+public:
+    /** the coroutine awaiting this task. */
+    std::coroutine_handle<> continuation{std::noop_coroutine()};
+
+    /** the exception thrown by the task, if any. */
+    std::exception_ptr exception;
+
+    /** tasks are lazy, i.e., they start when they are awaited. */
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    /** resume the awaiting coroutine. */
+    final_awaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    /** store the exception, to be rethrown in the awaiting coroutine. */
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    /** rethrow a stored exception. */
+    void rethrow_if_exception()
+    {
+        if(exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+/** promise of task<T>. */
+template<typename T>
+class task_promise : public task_promise_base
+{
+    /** the result. */
+    std::optional<T> value;
+
+public:
+    /** create the task. */
+    task<T> get_return_object() noexcept;
+
+    /** store the result. */
+    template<typename U>
+    void return_value(U&& in_value)
+    {
+        value.emplace(std::forward<U>(in_value));
+    }
+
+    /** return the result or rethrow the task's exception. */
+    T result()
+    {
+        rethrow_if_exception();
+        return std::move(*value);
+    }
+};
+
+/** promise of task<void>. */
+template<>
+class task_promise<void> : public task_promise_base
+{
+public:
+    /** create the task. */
+    task<void> get_return_object() noexcept;
+
+    /** nothing to store. */
+    void return_void() noexcept
+    {
+    }
+
+    /** rethrow the task's exception. */
+    void result()
+    {
+        rethrow_if_exception();
+    }
+};
+
+} /* namespace detail */
+
+/**
+ * a lazily started coroutine producing a value of type T. the coroutine starts when the task is awaited, and the awaiting
+ * coroutine is resumed (on the thread that finished the task) once it completes. exceptions are rethrown on co_await.
+ *
+ * use co_await pool.schedule() inside the coroutine to continue on one of the pool's workers.
+ */
+template<typename T>
+class task
+{
+    static_assert(!std::is_reference_v<T>, "task: references are not supported. return a pointer or a std::reference_wrapper instead.");
+
+public:
+    /** promise type. */
+    using promise_type = detail::task_promise<T>;
+
+private:
+    /** the coroutine. */
+    std::coroutine_handle<promise_type> handle;
+
+    /** awaiter starting the task. */
+    struct awaiter
+    {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() const noexcept
+        {
+            return !handle || handle.done();
+        }
+
+        /** remember the awaiting coroutine and start the task. */
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume()
+        {
+            return handle.promise().result();
+        }
+    };
+
+public:
+    /** create an empty task. */
+    task() = default;
+
+    /** take ownership of a coroutine. */
+    explicit task(std::coroutine_handle<promise_type> in_handle) noexcept
+    : handle{in_handle}
+    {
+    }
+
+    /** move constructor. */
+    task(task&& other) noexcept
+    : handle{std::exchange(other.handle, nullptr)}
+    {
+    }
+
+    /** move assignment. */
+    task& operator=(task&& other) noexcept
+    {
+        if(this != &other)
+        {
+            if(handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    /** tasks are move-only. */
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    /** destructor. the task must not be running. */
+    ~task()
+    {
+        if(handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    /** check whether the task holds a coroutine. */
+    bool valid() const noexcept
+    {
+        return static_cast<bool>(handle);
+    }
+
+    /** check whether the coroutine finished. */
+    bool is_ready() const noexcept
+    {
+        return handle && handle.done();
+    }
+
+    /** start the task and suspend until it finished. */
+    awaiter operator co_await() const noexcept
+    {
+        return awaiter{handle};
+    }
+};
+
+namespace detail
+{
+
+template<typename T>
+task<T> task_promise<T>::get_return_object() noexcept
+{
+    return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept
+{
+    return task<void>{std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+}
+
+/** state of a sync_wait call. */
+template<typename T>
+struct sync_wait_state
+{
+    /** the result. void results store nothing. */
+    std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+
+    /** the task's exception. */
+    std::exception_ptr exception;
+
+    /** mutex protecting done. the driver signals while holding it, so that the state outlives the notification. */
+    std::mutex done_mutex;
+
+    /** signals completion. */
+    std::condition_variable done_signal;
+
+    /** whether the task finished. */
+    bool done{false};
+};
+
+/** an eagerly started coroutine, which destroys itself when it finishes. */
+struct detached_coroutine
+{
+    struct promise_type
+    {
+        detached_coroutine get_return_object() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+/** await a task and store its result in the state. */
+template<typename T>
+detached_coroutine sync_wait_driver(task<T>& t, sync_wait_state<T>& state)
+{
+    try
+    {
+        if constexpr(std::is_void_v<T>)
+        {
+            co_await t;
+            state.value.emplace(true);
+        }
+        else
+        {
+            state.value.emplace(co_await t);
+        }
+    }
+    catch(...)
+    {
+        state.exception = std::current_exception();
+    }
+
+    std::unique_lock lock{state.done_mutex};
+    state.done = true;
+    state.done_signal.notify_one();
+}
+
+} /* namespace detail */
+
+/** start a task, block the calling thread until it finished, and return its result. must not be called from a worker the task depends on. */
+template<typename T>
+T sync_wait(task<T> t)
+{
+    detail::sync_wait_state<T> state;
+    detail::sync_wait_driver(t, state);
+
+    {
+        std::unique_lock lock{state.done_mutex};
+        state.done_signal.wait(lock, [&state]() -> bool
+                               { return state.done; });
+    }
+
+    if(state.exception)
+    {
+        std::rethrow_exception(state.exception);
+    }
+
+    if constexpr(!std::is_void_v<T>)
+    {
+        return std::move(*state.value);
+    }
+}
+
+} /* namespace concurrency_utils */
+
+#endif /* defined(CONCURRENCY_UTILS_HAS_COROUTINES) */
@@ -0,0 +1,180 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * epoch-based memory reclamation for the lock-free queues. threads announce the epoch in which they started accessing
+ * shared nodes, and retired nodes are only reused once every thread that could still see them has left its critical section.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "common.h"
+
+namespace concurrency_utils
+{
+
+namespace detail
+{
+
+/**
+ * process-wide epoch domain. every thread owns a record, which holds the epoch announced by the thread while it is
+ * inside a critical section, or 0 while it is quiescent. records are claimed on first use, handed back when the thread
+ * exits and reused by later threads, so the list only grows with the maximum number of concurrently running threads.
+ *
+ * usage: hold a guard while accessing nodes that may be retired concurrently. to retire a node, unlink it and tag it
+ * with retire(). the node may be reused once is_safe(tag, oldest_epoch()) returns true.
+ */
+class epoch_domain
+{
+    /** per-thread record. */
+    struct alignas(cache_line_size) record
+    {
+        /** the announced epoch, or 0 if the thread is not inside a critical section. */
+        std::atomic_uint64_t epoch{0};
+
+        /** whether the record is owned by a thread. */
+        std::atomic_bool in_use{true};
+
+        /** nesting depth of the owner's guards. only accessed by the owner. */
+        std::size_t depth{0};
+
+        /** next record. records are never removed from the list. */
+        record* next{nullptr};
+    };
+
+    /** the global epoch. starts at 1, since 0 marks quiescent records. */
+    alignas(cache_line_size) std::atomic_uint64_t global_epoch{1};
+
+    /** list of all records. */
+    alignas(cache_line_size) std::atomic<record*> records{nullptr};
+
+    /** claim an unused record or append a new one. */
+    record* acquire_record()
+    {
+        for(auto r = records.load(std::memory_order_acquire); r != nullptr; r = r->next)
+        {
+            bool expected = false;
+            if(!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return r;
+            }
+        }
+
+        auto r = new record;
+        auto head = records.load(std::memory_order_relaxed);
+        do
+        {
+            r->next = head;
+        } while(!records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+
+        return r;
+    }
+
+    /** owner of the calling thread's record. hands the record back when the thread exits. */
+    struct thread_record
+    {
+        record* r{nullptr};
+
+        ~thread_record()
+        {
+            if(r)
+            {
+                r->in_use.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    /** return the calling thread's record. */
+    record& get_record()
+    {
+        static thread_local thread_record local;
+        if(!local.r)
+        {
+            local.r = acquire_record();
+        }
+        return *local.r;
+    }
+
+    epoch_domain() = default;
+
+public:
+    /** the domain shared by all queues. the domain and its records live until the program exits. */
+    static epoch_domain& instance()
+    {
+        static epoch_domain* domain = new epoch_domain;
+        return *domain;
+    }
+
+    /** critical section. nodes seen inside the section are not reused before the guard is destroyed. guards can be nested. */
+    class guard
+    {
+        /** the calling thread's record. */
+        record& r;
+
+    public:
+        /** enter the critical section. */
+        explicit guard(epoch_domain& domain)
+        : r{domain.get_record()}
+        {
+            if(r.depth++ == 0)
+            {
+                // the announcement has to be visible before any shared node is read, hence sequential consistency.
+                r.epoch.store(domain.global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            }
+        }
+
+        /** leave the critical section. */
+        ~guard()
+        {
+            if(--r.depth == 0)
+            {
+                r.epoch.store(0, std::memory_order_release);
+            }
+        }
+
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+    };
+
+    /** advance the epoch after a node was unlinked. returns the tag for the node. */
+    std::uint64_t retire()
+    {
+        return global_epoch.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    /** return the oldest epoch announced by a thread inside a critical section, or the maximum value if there is none. */
+    std::uint64_t oldest_epoch() const
+    {
+        auto oldest = std::numeric_limits<std::uint64_t>::max();
+        for(auto r = records.load(std::memory_order_acquire); r != nullptr; r = r->next)
+        {
+            auto e = r->epoch.load(std::memory_order_seq_cst);
+            if(e != 0 && e < oldest)
+            {
+                oldest = e;
+            }
+        }
+
+        return oldest;
+    }
+
+    /** check whether a node retired with the given tag can be reused, given the result of oldest_epoch. */
+    static bool is_safe(std::uint64_t tag, std::uint64_t oldest)
+    {
+        // threads that announced an epoch after the tag entered after the node was unlinked.
+        return tag < oldest;
+    }
+};
+
+} /* namespace detail */
+
+} /* namespace concurrency_utils */
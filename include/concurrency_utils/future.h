@@ -0,0 +1,395 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * futures for results of submitted tasks. the shared states are allocated from a free-list slab.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "wait_policy.h"
+
+namespace concurrency_utils
+{
+
+namespace detail
+{
+
+/**
+ * free-list slab of fixed-size blocks. blocks are allocated in chunks and only returned to the system on
+ * destruction, so that steady-state allocations do not hit the global allocator. larger requests fall back
+ * to operator new. thread-safe.
+ */
+class block_pool
+{
+public:
+    /** size of a block. */
+    static constexpr std::size_t block_size = 256;
+
+    /** number of blocks allocated at once. */
+    static constexpr std::size_t blocks_per_chunk = 64;
+
+private:
+    /** a block is either free (and part of the free list) or holds user data. */
+    union block
+    {
+        block* next;
+        alignas(std::max_align_t) unsigned char storage[block_size];
+    };
+
+    /** mutex protecting the free list. */
+    std::mutex pool_mutex;
+
+    /** first free block. */
+    block* free_list{nullptr};
+
+    /** allocated chunks. */
+    std::vector<std::unique_ptr<block[]>> chunks;
+
+public:
+    /** default constructor. */
+    block_pool() = default;
+
+    /** disable copying. */
+    block_pool(const block_pool&) = delete;
+    block_pool& operator=(const block_pool&) = delete;
+
+    /** allocate memory of the given size and alignment. */
+    void* allocate(std::size_t size, std::size_t alignment)
+    {
+        if(size > block_size || alignment > alignof(std::max_align_t))
+        {
+            return ::operator new(size, std::align_val_t{alignment});
+        }
+
+        std::unique_lock lock{pool_mutex};
+        if(!free_list)
+        {
+            auto& chunk = chunks.emplace_back(std::make_unique<block[]>(blocks_per_chunk));
+            for(std::size_t i = 0; i < blocks_per_chunk; ++i)
+            {
+                chunk[i].next = free_list;
+                free_list = &chunk[i];
+            }
+        }
+
+        auto b = free_list;
+        free_list = b->next;
+        return b->storage;
+    }
+
+    /** return memory obtained from allocate. size and alignment have to match the values used for the allocation. */
+    void deallocate(void* p, std::size_t size, std::size_t alignment)
+    {
+        if(size > block_size || alignment > alignof(std::max_align_t))
+        {
+            ::operator delete(p, std::align_val_t{alignment});
+            return;
+        }
+
+        auto b = ::new(p) block;
+
+        std::unique_lock lock{pool_mutex};
+        b->next = free_list;
+        free_list = b;
+    }
+};
+
+/** state shared between a future and the task computing its value. */
+template<typename R>
+class future_state
+{
+    /** the stored value. void results store nothing. */
+    using value_type = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+    /** the pool this state was allocated from. */
+    block_pool* allocator;
+
+    /** references held by the future and the promises. */
+    std::atomic_uint references{2};
+
+    /** references held by promises. */
+    std::atomic_uint promises{1};
+
+    /** whether a value or an exception was stored. */
+    std::atomic_bool ready{false};
+
+    /** waits for the value. */
+    backoff_wait<> completion;
+
+    /** the value, if the task succeeded. */
+    std::optional<value_type> value;
+
+    /** the exception, if the task failed. */
+    std::exception_ptr exception;
+
+    /** constructor. */
+    explicit future_state(block_pool* in_allocator)
+    : allocator{in_allocator}
+    {
+    }
+
+    /** mark the state as ready and notify waiting threads. */
+    void set_ready()
+    {
+        ready = true;
+        completion.notify();
+    }
+
+public:
+    /** allocate a new state from the given pool. */
+    static future_state* create(block_pool& pool)
+    {
+        return ::new(pool.allocate(sizeof(future_state), alignof(future_state))) future_state{&pool};
+    }
+
+    /** add a reference held by a promise. */
+    void add_promise()
+    {
+        ++references;
+        ++promises;
+    }
+
+    /** drop a reference held by a promise. the last promise breaks the promise if no result was stored. */
+    void release_promise()
+    {
+        if(--promises == 0 && !ready)
+        {
+            exception = std::make_exception_ptr(std::future_error{std::future_errc::broken_promise});
+            set_ready();
+        }
+
+        release();
+    }
+
+    /** drop a reference. the last reference returns the state to its pool. */
+    void release()
+    {
+        if(--references == 0)
+        {
+            auto pool = allocator;
+            this->~future_state();
+            pool->deallocate(this, sizeof(future_state), alignof(future_state));
+        }
+    }
+
+    /** run a callable and store its result or its exception. */
+    template<typename F>
+    void run(F& f)
+    {
+        try
+        {
+            if constexpr(std::is_void_v<R>)
+            {
+                f();
+                value.emplace();
+            }
+            else
+            {
+                value.emplace(f());
+            }
+        }
+        catch(...)
+        {
+            exception = std::current_exception();
+        }
+
+        set_ready();
+    }
+
+    /** check whether the result is available. */
+    bool is_ready() const
+    {
+        return ready;
+    }
+
+    /** wait until the result is available. */
+    void wait()
+    {
+        completion.wait([this]() -> bool
+                        { return ready; });
+    }
+
+    /** wait for the result and return it. rethrows the task's exception. */
+    R get()
+    {
+        wait();
+
+        if(exception)
+        {
+            std::rethrow_exception(exception);
+        }
+
+        if constexpr(!std::is_void_v<R>)
+        {
+            return std::move(*value);
+        }
+    }
+};
+
+/** the task's handle on the shared state. copyable, so that it can be stored inside std::function. */
+template<typename R>
+class promise
+{
+    /** the shared state. */
+    future_state<R>* state{nullptr};
+
+public:
+    /** take over the initial promise reference on a state. */
+    explicit promise(future_state<R>* in_state)
+    : state{in_state}
+    {
+    }
+
+    /** copy constructor. */
+    promise(const promise& other)
+    : state{other.state}
+    {
+        if(state)
+        {
+            state->add_promise();
+        }
+    }
+
+    /** move constructor. */
+    promise(promise&& other) noexcept
+    : state{other.state}
+    {
+        other.state = nullptr;
+    }
+
+    /** disable assignment. */
+    promise& operator=(const promise&) = delete;
+
+    /** destructor. */
+    ~promise()
+    {
+        if(state)
+        {
+            state->release_promise();
+        }
+    }
+
+    /** run a callable and store its result in the shared state. */
+    template<typename F>
+    void run(F& f)
+    {
+        state->run(f);
+    }
+};
+
+} /* namespace detail */
+
+/** the result of a task submitted to a thread pool. the future must not outlive the thread pool. */
+template<typename R>
+class future
+{
+    /** the shared state. nullptr if the future is not valid. */
+    detail::future_state<R>* state{nullptr};
+
+public:
+    /** default constructor creates an invalid future. */
+    future() = default;
+
+    /** construct the future from a state. takes over the state's future reference. */
+    explicit future(detail::future_state<R>* in_state)
+    : state{in_state}
+    {
+    }
+
+    /** move constructor. */
+    future(future&& other) noexcept
+    : state{other.state}
+    {
+        other.state = nullptr;
+    }
+
+    /** move assignment. */
+    future& operator=(future&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            state = other.state;
+            other.state = nullptr;
+        }
+
+        return *this;
+    }
+
+    /** futures are move-only. */
+    future(const future&) = delete;
+    future& operator=(const future&) = delete;
+
+    /** destructor. */
+    ~future()
+    {
+        reset();
+    }
+
+    /** check whether the future refers to a shared state. */
+    bool valid() const
+    {
+        return state != nullptr;
+    }
+
+    /** check whether the result is available without blocking. the future has to be valid. */
+    bool is_ready() const
+    {
+        return state->is_ready();
+    }
+
+    /** wait for the result. only waits for this task, not for the whole queue. the future has to be valid. */
+    void wait() const
+    {
+        state->wait();
+    }
+
+    /** wait for the result and return it. rethrows the exception if the task threw. invalidates the future. */
+    R get()
+    {
+        auto s = state;
+        state = nullptr;
+
+        struct release_on_exit
+        {
+            detail::future_state<R>* s;
+            ~release_on_exit()
+            {
+                s->release();
+            }
+        } guard{s};
+
+        return s->get();
+    }
+
+private:
+    /** release the shared state. */
+    void reset()
+    {
+        if(state)
+        {
+            state->release();
+            state = nullptr;
+        }
+    }
+};
+
+} /* namespace concurrency_utils */
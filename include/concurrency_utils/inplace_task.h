@@ -0,0 +1,149 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * a move-only task type that stores its callable inside a fixed-size buffer, i.e., that never allocates.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace concurrency_utils
+{
+
+/**
+ * a move-only replacement for std::function<void()>, which stores the callable inline. callables that
+ * do not fit into the buffer are rejected at compile time.
+ *
+ * the task can be used as the value type of all queues, e.g. deferred_thread_pool<spmc_queue<inplace_task<64>>>.
+ */
+template<std::size_t capacity = 64, std::size_t alignment = alignof(std::max_align_t)>
+class inplace_task
+{
+    /** operations on the stored callable. */
+    struct operations
+    {
+        /** invoke the callable. */
+        void (*invoke)(void*);
+
+        /** move-construct the callable into uninitialized storage and destroy the source. */
+        void (*relocate)(void* dst, void* src);
+
+        /** destroy the callable. */
+        void (*destroy)(void*);
+    };
+
+    /** operations for a specific callable type. */
+    template<typename F>
+    static constexpr operations operations_for = {
+      [](void* f)
+      { std::invoke(*static_cast<F*>(f)); },
+      [](void* dst, void* src)
+      {
+          ::new(dst) F(std::move(*static_cast<F*>(src)));
+          static_cast<F*>(src)->~F();
+      },
+      [](void* f)
+      { static_cast<F*>(f)->~F(); }};
+
+    /** storage for the callable. */
+    alignas(alignment) unsigned char storage[capacity];
+
+    /** operations of the stored callable. nullptr if the task is empty. */
+    const operations* ops{nullptr};
+
+public:
+    /** whether a callable of type F can be stored in the task, i.e., whether the converting constructor accepts it. */
+    template<typename F>
+    static constexpr bool can_store = sizeof(std::decay_t<F>) <= capacity && alignof(std::decay_t<F>) <= alignment && std::is_nothrow_move_constructible_v<std::decay_t<F>>;
+
+    /** default constructor creates an empty task. */
+    inplace_task() = default;
+
+    /** construct the task from a callable. */
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, inplace_task>>>
+    inplace_task(F&& f)
+    {
+        using callable = std::decay_t<F>;
+
+        static_assert(sizeof(callable) <= capacity, "inplace_task: the callable does not fit into the task storage. increase the capacity.");
+        static_assert(alignof(callable) <= alignment, "inplace_task: the callable's alignment is too large for the task storage.");
+        static_assert(std::is_nothrow_move_constructible_v<callable>, "inplace_task: the callable needs to be nothrow move constructible.");
+        static_assert(std::is_invocable_v<callable&>, "inplace_task: the callable needs to be invocable without arguments.");
+
+        ::new(storage) callable(std::forward<F>(f));
+        ops = &operations_for<callable>;
+    }
+
+    /** move constructor. */
+    inplace_task(inplace_task&& other) noexcept
+    : ops{other.ops}
+    {
+        if(ops)
+        {
+            ops->relocate(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+
+    /** move assignment. */
+    inplace_task& operator=(inplace_task&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+
+            if(other.ops)
+            {
+                other.ops->relocate(storage, other.storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
+        }
+
+        return *this;
+    }
+
+    /** tasks are move-only. */
+    inplace_task(const inplace_task&) = delete;
+    inplace_task& operator=(const inplace_task&) = delete;
+
+    /** destructor. */
+    ~inplace_task()
+    {
+        reset();
+    }
+
+    /** destroy the stored callable. */
+    void reset()
+    {
+        if(ops)
+        {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    /** invoke the stored callable. the task must not be empty. */
+    void operator()()
+    {
+        ops->invoke(storage);
+    }
+
+    /** check whether the task holds a callable. */
+    explicit operator bool() const
+    {
+        return ops != nullptr;
+    }
+};
+
+} /* namespace concurrency_utils */
@@ -0,0 +1,293 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * parallel loops on top of deferred_thread_pool.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+namespace concurrency_utils
+{
+
+/** how a loop range is split into tasks. */
+enum class partition
+{
+    /** equally sized chunks, a few per worker. */
+    static_chunks,
+
+    /** chunks of decreasing size. large chunks first keep queue traffic low, small chunks at the end balance the load. */
+    guided,
+
+    /**
+     * guided chunk sizes, claimed through a shared cursor by one task per worker. a worker which finishes early claims
+     * more chunks, without a queue operation per chunk. without a grain size, the smallest chunk is derived from the range length.
+     */
+    automatic
+};
+
+namespace detail
+{
+
+/** number of chunks per worker for static partitioning. */
+constexpr std::size_t chunks_per_worker = 4;
+
+/** split [begin, end) into chunks according to the partitioning mode. chunks are never smaller than the grain size (except for the last one). */
+template<typename Index>
+std::vector<std::pair<Index, Index>> make_chunks(Index begin, Index end, std::size_t grain, std::size_t thread_count, partition mode)
+{
+    std::vector<std::pair<Index, Index>> chunks;
+    if(!(begin < end))
+    {
+        return chunks;
+    }
+
+    const std::size_t length = static_cast<std::size_t>(end - begin);
+    const std::size_t workers = std::max<std::size_t>(thread_count, 1);
+    std::size_t min_chunk = std::max<std::size_t>(grain, 1);
+
+    if(mode == partition::automatic && grain == 0)
+    {
+        min_chunk = std::max<std::size_t>(length / (2 * chunks_per_worker * workers), 1);
+    }
+
+    if(mode == partition::guided || mode == partition::automatic)
+    {
+        std::size_t first = 0;
+        while(first < length)
+        {
+            auto chunk = std::max(min_chunk, (length - first) / (2 * workers));
+            chunk = std::min(chunk, length - first);
+
+            chunks.emplace_back(static_cast<Index>(begin + first), static_cast<Index>(begin + first + chunk));
+            first += chunk;
+        }
+    }
+    else
+    {
+        const auto chunk_count = chunks_per_worker * workers;
+        const auto chunk = std::max(min_chunk, (length + chunk_count - 1) / chunk_count);
+
+        chunks.reserve((length + chunk - 1) / chunk);
+        for(std::size_t first = 0; first < length; first += chunk)
+        {
+            auto last = std::min(first + chunk, length);
+            chunks.emplace_back(static_cast<Index>(begin + first), static_cast<Index>(begin + last));
+        }
+    }
+
+    return chunks;
+}
+
+/**
+ * split [0, length) into one contiguous block per worker. if the output starts at out_address, all block boundaries
+ * except the range's ends fall on cache line boundaries of the output, so no two workers write to the same cache line.
+ */
+template<typename U>
+std::vector<std::pair<std::size_t, std::size_t>> make_aligned_blocks(std::size_t length, std::size_t thread_count, const U* out_address)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> blocks;
+    if(length == 0)
+    {
+        return blocks;
+    }
+
+    // number of elements per cache line, and the elements before the first line boundary.
+    std::size_t line_elements = 1;
+    std::size_t head = 0;
+    if constexpr(cache_line_size % sizeof(U) == 0)
+    {
+        line_elements = cache_line_size / sizeof(U);
+        const auto misalignment = (reinterpret_cast<std::uintptr_t>(out_address) % cache_line_size) / sizeof(U);
+        head = (line_elements - misalignment) % line_elements;
+    }
+
+    const std::size_t workers = std::max<std::size_t>(thread_count, 1);
+    auto block = (length + workers - 1) / workers;
+    block = (block + line_elements - 1) / line_elements * line_elements;
+
+    // the first block also takes the elements before the first line boundary.
+    for(std::size_t first = 0, last = std::min(head + block, length); first < length; first = last, last = std::min(last + block, length))
+    {
+        blocks.emplace_back(first, last);
+    }
+
+    return blocks;
+}
+
+/**
+ * call run_chunk(c) for every chunk index c in [0, chunk_count) on the pool, and run the pool's task queue. automatic
+ * partitioning pushes one task per worker, which claim the chunks through a shared cursor. otherwise, every chunk is a task.
+ */
+template<typename Pool, typename RunChunk>
+void run_chunks(Pool& pool, std::size_t chunk_count, partition mode, RunChunk& run_chunk)
+{
+    // the tasks only capture a pointer and an index, which fits into the small buffer of std::function.
+    if(mode == partition::automatic)
+    {
+        struct context
+        {
+            alignas(cache_line_size) std::atomic_size_t cursor{0};
+            std::size_t chunk_count;
+            RunChunk& run_chunk;
+        } ctx{{0}, chunk_count, run_chunk};
+
+        const auto runner_count = std::min(std::max<std::size_t>(pool.get_thread_count(), 1), chunk_count);
+        for(std::size_t r = 0; r < runner_count; ++r)
+        {
+            pool.push_task([ctx = &ctx]()
+                           {
+                               for(auto c = ctx->cursor.fetch_add(1, std::memory_order_relaxed); c < ctx->chunk_count; c = ctx->cursor.fetch_add(1, std::memory_order_relaxed))
+                               {
+                                   ctx->run_chunk(c);
+                               }
+                           });
+        }
+    }
+    else
+    {
+        for(std::size_t c = 0; c < chunk_count; ++c)
+        {
+            pool.push_task([&run_chunk, c]()
+                           { run_chunk(c); });
+        }
+    }
+
+    pool.run_tasks_and_wait();
+}
+
+/** a partial result, padded to a cache line to prevent false sharing between the workers. */
+template<typename T>
+struct alignas(cache_line_size) padded_value
+{
+    T value;
+};
+
+} /* namespace detail */
+
+/**
+ * call body(i) for all i in [begin, end), distributing chunks of the range over the threads of the pool. the index type
+ * is the common type of begin and end, e.g. parallel_for(pool, 0, v.size(), 64, body) iterates over std::size_t.
+ * the call pushes the chunks' tasks and then runs the pool's task queue, i.e., it also runs and waits for previously queued tasks.
+ */
+template<typename Pool, typename Begin, typename End, typename Body>
+void parallel_for(Pool& pool, Begin begin, End end, std::size_t grain, Body&& body, partition mode = partition::automatic)
+{
+    using Index = std::common_type_t<Begin, End>;
+
+    auto chunks = detail::make_chunks<Index>(begin, end, grain, pool.get_thread_count(), mode);
+    if(chunks.empty())
+    {
+        return;
+    }
+
+    auto run_chunk = [&chunks, &body](std::size_t c)
+    {
+        auto [first, last] = chunks[c];
+        for(auto i = first; i < last; ++i)
+        {
+            body(i);
+        }
+    };
+    detail::run_chunks(pool, chunks.size(), mode, run_chunk);
+}
+
+/**
+ * reduce the range [begin, end), with the index type of parallel_for. every chunk starts with init and accumulates its indices through acc = op(acc, i).
+ * the partial results are combined in chunk order, as reduce(reduce(init, partial_0), partial_1)..., so init has to be the
+ * identity of reduce. the partial results are stored in separate cache lines.
+ *
+ * as parallel_for, this runs (and waits for) the pool's whole task queue.
+ */
+template<typename Pool, typename Begin, typename End, typename T, typename Op, typename Reduce>
+T parallel_reduce(Pool& pool, Begin begin, End end, std::size_t grain, T init, Op&& op, Reduce&& reduce, partition mode = partition::automatic)
+{
+    using Index = std::common_type_t<Begin, End>;
+
+    auto chunks = detail::make_chunks<Index>(begin, end, grain, pool.get_thread_count(), mode);
+    if(chunks.empty())
+    {
+        return init;
+    }
+
+    std::vector<detail::padded_value<T>> partials(chunks.size(), detail::padded_value<T>{init});
+
+    auto run_chunk = [&chunks, &partials, &op](std::size_t c)
+    {
+        auto [first, last] = chunks[c];
+
+        // accumulate locally and only write the result once.
+        T acc = std::move(partials[c].value);
+        for(auto i = first; i < last; ++i)
+        {
+            acc = op(std::move(acc), i);
+        }
+        partials[c].value = std::move(acc);
+    };
+    detail::run_chunks(pool, chunks.size(), mode, run_chunk);
+
+    T result = std::move(init);
+    for(auto& it: partials)
+    {
+        result = reduce(std::move(result), std::move(it.value));
+    }
+
+    return result;
+}
+
+/**
+ * store op(in[i]) to out[i] for all i in [0, last - first). in contrast to parallel_for, every worker gets exactly one
+ * contiguous block of the range, and the block boundaries are aligned to the output's cache lines. this suits
+ * compute-dense, evenly loaded kernels, e.g. on SIMD batches: each worker streams through its own memory, and no
+ * cache line is written by two workers.
+ *
+ * the input and output have to be contiguous. the output may alias the input. as parallel_for, this runs (and waits for)
+ * the pool's whole task queue.
+ */
+template<typename Pool, typename T, typename U, typename Op>
+void parallel_transform(Pool& pool, const T* first, const T* last, U* out, Op&& op)
+{
+    auto blocks = detail::make_aligned_blocks(static_cast<std::size_t>(last - first), pool.get_thread_count(), out);
+    if(blocks.empty())
+    {
+        return;
+    }
+
+    struct context
+    {
+        const std::vector<std::pair<std::size_t, std::size_t>>& blocks;
+        const T* in;
+        U* out;
+        Op& op;
+    } ctx{blocks, first, out, op};
+
+    for(std::size_t b = 0; b < blocks.size(); ++b)
+    {
+        pool.push_task([ctx = &ctx, b]()
+                       {
+                           auto [block_first, block_last] = ctx->blocks[b];
+                           for(auto i = block_first; i < block_last; ++i)
+                           {
+                               ctx->out[i] = ctx->op(ctx->in[i]);
+                           }
+                       });
+    }
+
+    pool.run_tasks_and_wait();
+}
+
+} /* namespace concurrency_utils */
@@ -0,0 +1,181 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * producer/consumer chains. every stage runs on its own pool thread, and neighbouring stages are connected by spsc_rings.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "queues/spsc_ring.h"
+#include "thread_pool.h"
+
+namespace concurrency_utils
+{
+
+namespace detail
+{
+
+/**
+ * closes a ring when the task of a stage is destroyed, i.e., after the stage finished or threw, or if the pool skipped
+ * the task (see set_cancel_on_error). this ends the neighbouring stages instead of leaving them waiting.
+ */
+template<typename T>
+class ring_closer
+{
+    spsc_ring<T>& ring;
+
+public:
+    explicit ring_closer(spsc_ring<T>& in_ring)
+    : ring{in_ring}
+    {
+    }
+
+    ring_closer(const ring_closer&) = delete;
+    ring_closer& operator=(const ring_closer&) = delete;
+
+    ~ring_closer()
+    {
+        ring.close();
+    }
+};
+
+/** create a closer shared by all copies of a stage's task. */
+template<typename T>
+std::shared_ptr<ring_closer<T>> make_ring_closer(spsc_ring<T>& ring)
+{
+    return std::make_shared<ring_closer<T>>(ring);
+}
+
+/** the element type a source produces, i.e. T for a source returning std::optional<T>. */
+template<typename Source>
+using source_value_t = typename std::invoke_result_t<Source&>::value_type;
+
+} /* namespace detail */
+
+/**
+ * a chain of stages: a source, any number of transforming stages and a sink.
+ *  - the source returns std::optional<T>, where an empty optional ends the stream,
+ *  - a transforming stage takes an element and returns the element for the next stage,
+ *  - the sink takes an element and returns nothing.
+ *
+ * run(pool) connects the stages through spsc_rings of the given capacity and runs every stage on its own worker of a
+ * deferred_thread_pool. a stage waits while its output ring is full, so a slow stage throttles the stages before it.
+ * if a stage throws, the rings are closed, the other stages stop, and run rethrows as run_tasks_and_wait.
+ *
+ * the element types need to be default constructible and movable.
+ */
+template<typename Source, typename... Stages>
+class pipeline
+{
+    static_assert(sizeof...(Stages) > 0, "pipeline: a pipeline needs a source and a sink.");
+
+    /** the stages, source first. */
+    std::tuple<Source, Stages...> stages;
+
+    /** capacity of the rings between the stages. */
+    std::size_t ring_capacity;
+
+    /** spawn the stage reading from the given ring. creates the stage's output ring, and runs the pool once all stages are spawned. */
+    template<std::size_t I, typename Pool, typename T>
+    void spawn_stages(Pool& pool, task_group& group, spsc_ring<T>& in)
+    {
+        auto& stage = std::get<I>(stages);
+        if constexpr(I + 1 == stage_count)
+        {
+            pool.spawn(group, [&in, &stage, close_in = detail::make_ring_closer(in)]()
+                       {
+                           T value;
+                           while(in.pop(value))
+                           {
+                               stage(std::move(value));
+                           }
+                       });
+
+            pool.run_tasks_and_wait();
+        }
+        else
+        {
+            using output_type = std::decay_t<std::invoke_result_t<decltype(stage)&, T&&>>;
+            spsc_ring<output_type> out{ring_capacity};
+
+            pool.spawn(group, [&in, &out, &stage, close_in = detail::make_ring_closer(in), close_out = detail::make_ring_closer(out)]()
+                       {
+                           T value;
+                           while(in.pop(value))
+                           {
+                               if(!out.push(stage(std::move(value))))
+                               {
+                                   break;
+                               }
+                           }
+                       });
+
+            spawn_stages<I + 1>(pool, group, out);
+        }
+    }
+
+public:
+    /** number of stages, including the source and the sink. this is the number of threads run needs. */
+    static constexpr std::size_t stage_count = 1 + sizeof...(Stages);
+
+    /** constructor. */
+    explicit pipeline(std::size_t in_ring_capacity, Source source, Stages... in_stages)
+    : stages{std::move(source), std::move(in_stages)...}
+    , ring_capacity{in_ring_capacity}
+    {
+    }
+
+    /**
+     * run the pipeline until the source is exhausted and the sink consumed all elements. the stages are spawned as child
+     * tasks, which the workers take one at a time, so every stage gets its own worker. the pool needs at least stage_count
+     * threads, and it runs (and waits for) its whole task queue, as run_tasks_and_wait.
+     */
+    template<typename Pool>
+    void run(Pool& pool)
+    {
+        if(pool.get_thread_count() < stage_count)
+        {
+            throw std::invalid_argument("pipeline: the pool needs one thread per stage.");
+        }
+
+        using value_type = detail::source_value_t<Source>;
+        spsc_ring<value_type> out{ring_capacity};
+
+        auto& source = std::get<0>(stages);
+        task_group group;
+        pool.spawn(group, [&out, &source, close_out = detail::make_ring_closer(out)]()
+                   {
+                       while(auto value = source())
+                       {
+                           if(!out.push(std::move(*value)))
+                           {
+                               break;
+                           }
+                       }
+                   });
+
+        spawn_stages<1>(pool, group, out);
+    }
+};
+
+/** create a pipeline from a source, transforming stages and a sink, connected by rings of the given capacity. see pipeline. */
+template<typename Source, typename... Stages>
+pipeline<std::decay_t<Source>, std::decay_t<Stages>...> make_pipeline(std::size_t ring_capacity, Source&& source, Stages&&... stages)
+{
+    return pipeline<std::decay_t<Source>, std::decay_t<Stages>...>{ring_capacity, std::forward<Source>(source), std::forward<Stages>(stages)...};
+}
+
+} /* namespace concurrency_utils */
@@ -8,6 +8,13 @@
  * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
  */
 
+#pragma once
+
 #include "queues/spmc_blocking.h"
 #include "queues/spmc_nonblocking.h"
 #include "queues/mpmc_blocking.h"
+#include "queues/mpmc_bounded.h"
+#include "queues/mpmc_segmented.h"
+#include "queues/spsc_ring.h"
+#include "queues/work_stealing.h"
+#include "queues/priority_lanes.h"
@@ -0,0 +1,149 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * compile-time properties of queues. the thread pools use them to reject unsuitable queues, and to select code paths,
+ * e.g. bulk pops, or whether pushes may run concurrently with the workers.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "common.h"
+
+namespace concurrency_utils
+{
+
+namespace detail
+{
+
+/** check whether a queue distinguishes its consumers, i.e., whether it provides set_consumer_count and try_pop(f, consumer_index). */
+template<typename queue_type, typename = void>
+struct has_consumer_index : std::false_type
+{
+};
+
+template<typename queue_type>
+struct has_consumer_index<queue_type, std::void_t<decltype(std::declval<queue_type&>().set_consumer_count(std::size_t{}))>> : std::true_type
+{
+};
+
+/** check whether a queue supports pushing ranges of elements, i.e., whether it provides push_bulk(first, last). */
+template<typename queue_type, typename = void>
+struct has_bulk_push : std::false_type
+{
+};
+
+template<typename queue_type>
+struct has_bulk_push<queue_type, std::void_t<decltype(std::declval<queue_type&>().push_bulk(std::declval<typename queue_type::value_type*>(), std::declval<typename queue_type::value_type*>()))>> : std::true_type
+{
+};
+
+/** check whether a queue supports popping multiple elements at once, i.e., whether it provides try_pop_bulk(out, max_n). */
+template<typename queue_type, typename = void>
+struct has_bulk_pop : std::false_type
+{
+};
+
+template<typename queue_type>
+struct has_bulk_pop<queue_type, std::void_t<decltype(std::declval<queue_type&>().try_pop_bulk(std::declval<typename queue_type::value_type*>(), std::size_t{}))>> : std::true_type
+{
+};
+
+/** check whether a queue supports priorities, i.e., whether it provides emplace_with_priority(priority, args...). */
+template<typename queue_type, typename = void>
+struct has_priorities : std::false_type
+{
+};
+
+template<typename queue_type>
+struct has_priorities<queue_type, std::void_t<decltype(std::declval<queue_type&>().emplace_with_priority(std::size_t{}, std::declval<typename queue_type::value_type>()))>> : std::true_type
+{
+};
+
+/** check whether a queue can drop all its elements at once, i.e., whether it provides discard(). */
+template<typename queue_type, typename = void>
+struct has_discard : std::false_type
+{
+};
+
+template<typename queue_type>
+struct has_discard<queue_type, std::void_t<decltype(std::declval<queue_type&>().discard())>> : std::true_type
+{
+};
+
+/** check whether a queue supports pushes which fail instead of waiting, i.e., whether it provides try_emplace(args...). */
+template<typename queue_type, typename = void>
+struct has_try_emplace : std::false_type
+{
+};
+
+template<typename queue_type>
+struct has_try_emplace<queue_type, std::void_t<decltype(std::declval<queue_type&>().try_emplace(std::declval<typename queue_type::value_type>()))>> : std::true_type
+{
+};
+
+/** check whether a type provides the operations a thread pool needs: value_type, emplace, try_pop, empty, size and clear. */
+template<typename queue_type, typename = void>
+struct is_pool_queue : std::false_type
+{
+};
+
+template<typename queue_type>
+struct is_pool_queue<queue_type, std::void_t<typename queue_type::value_type,
+                                             decltype(std::declval<queue_type&>().emplace(std::declval<typename queue_type::value_type>())),
+                                             decltype(std::declval<queue_type&>().try_pop(std::declval<typename queue_type::value_type&>())),
+                                             decltype(std::declval<const queue_type&>().empty()),
+                                             decltype(std::declval<const queue_type&>().size()),
+                                             decltype(std::declval<queue_type&>().clear())>> : std::true_type
+{
+};
+
+} /* namespace detail */
+
+/**
+ * properties of a queue type. the thread-safety properties are declared by the queues (concurrent_push_pop, bounded,
+ * single_consumer), the supported operations are detected.
+ */
+template<typename queue_type>
+struct queue_traits
+{
+    /** whether pushes are thread-safe, also while consumers pop. otherwise, pushes need to be sequential and must not overlap with pops. */
+    static constexpr bool is_multi_producer = detail::is_concurrent_queue<queue_type>::value;
+
+    /** whether multiple threads may pop concurrently. */
+    static constexpr bool is_multi_consumer = !detail::is_single_consumer_queue<queue_type>::value;
+
+    /** whether the capacity is fixed, i.e., pushes into a full queue wait or fail. */
+    static constexpr bool is_bounded = detail::is_bounded_queue<queue_type>::value;
+
+    /** whether the queue pushes ranges at once (push_bulk). */
+    static constexpr bool supports_bulk_push = detail::has_bulk_push<queue_type>::value;
+
+    /** whether the queue pops multiple elements at once (try_pop_bulk). */
+    static constexpr bool supports_bulk_pop = detail::has_bulk_pop<queue_type>::value;
+
+    /** whether the queue supports both bulk pushes and bulk pops. */
+    static constexpr bool supports_bulk = supports_bulk_push && supports_bulk_pop;
+
+    /** whether consumers pass their index to pop (set_consumer_count, try_pop(f, consumer_index)). */
+    static constexpr bool has_consumer_index = detail::has_consumer_index<queue_type>::value;
+
+    /** whether the queue has priority lanes (emplace_with_priority). */
+    static constexpr bool has_priorities = detail::has_priorities<queue_type>::value;
+
+    /** whether pushes can fail instead of waiting on a full queue (try_emplace). */
+    static constexpr bool has_try_emplace = detail::has_try_emplace<queue_type>::value;
+
+    /** whether all elements can be dropped at once while consumers pop (discard). */
+    static constexpr bool supports_discard = detail::has_discard<queue_type>::value;
+};
+
+} /* namespace concurrency_utils */
@@ -8,9 +8,15 @@
  * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
  */
 
+#pragma once
+
 // include dependencies
 #include <queue>
 #include <mutex>
+#include <utility>
+#include <algorithm>
+
+#include "../common.h"
 
 namespace concurrency_utils
 {
@@ -19,6 +25,14 @@ namespace concurrency_utils
 template<typename T>
 class mpmc_blocking_queue
 {
+public:
+    /** type of the stored elements. */
+    using value_type = T;
+
+    /** elements can be pushed while consumers pop. */
+    static constexpr bool concurrent_push_pop = true;
+
+private:
     /** read access mutex. */
     mutable std::mutex queue_mutex;
 
@@ -39,6 +53,29 @@ public:
         data.push_back(f);
     }
 
+    /** move an element into the container. blocking, thread-safe. */
+    void push(T&& f)
+    {
+        std::unique_lock mutex_lock{queue_mutex};
+        data.push_back(std::move(f));
+    }
+
+    /** construct an element in-place at the end of the container. blocking, thread-safe. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        std::unique_lock mutex_lock{queue_mutex};
+        data.emplace_back(std::forward<Args>(args)...);
+    }
+
+    /** push a range of elements into the container while holding the lock once. blocking, thread-safe. */
+    template<typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        std::unique_lock mutex_lock{queue_mutex};
+        data.insert(data.end(), first, last);
+    }
+
     /** try to pop an element off the container. blocking, thread-safe. */
     bool try_pop(T& f)
     {
@@ -55,10 +92,38 @@ public:
         return true;
     }
 
+    /** try to pop up to max_n elements off the container while holding the lock once. returns the number of popped elements. blocking, thread-safe. */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        std::unique_lock mutex_lock{queue_mutex};
+
+        auto count = std::min(max_n, data.size());
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            *out++ = std::move(data.front());
+            data.pop_front();
+        }
+
+        return count;
+    }
+
+    /** remove all elements without popping them. returns the number of removed elements. the elements are destroyed after releasing the lock. blocking, thread-safe. */
+    std::size_t discard()
+    {
+        decltype(data) discarded;
+        {
+            std::unique_lock mutex_lock{queue_mutex};
+            discarded.swap(data);
+        }
+
+        return discarded.size();
+    }
+
     /** clear container. blocking, thread-safe. */
     void clear()
     {
-        std::unique_lock{queue_mutex};
+        std::unique_lock mutex_lock{queue_mutex};
         data.clear();
     }
 
@@ -0,0 +1,284 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * bounded multiple producer (synchronized, non-blocking), multiple consumer (synchronized, non-blocking) queue.
+ * lock-free ring buffer with per-slot sequence numbers, following Dmitry Vyukov's design.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "../common.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * bounded multiple producer multiple consumer queue. the capacity is fixed at construction and rounded up to a power of two.
+ *
+ * push blocks (by spinning) while the queue is full. use try_push to detect a full queue. deferred_thread_pool does so,
+ * and starts its workers when a push finds the queue full, so the capacity does not need to hold a whole batch.
+ *
+ * as in Vyukov's design, only the two positions are padded to separate cache lines. the slots are packed, so that the
+ * memory used is about capacity * (sizeof(T) + sizeof(std::size_t)).
+ */
+template<typename T>
+class mpmc_bounded_queue
+{
+public:
+    /** type of the stored elements. */
+    using value_type = T;
+
+    /** elements can be pushed while consumers pop. */
+    static constexpr bool concurrent_push_pop = true;
+
+    /** the capacity is fixed. emplace spins while the queue is full. */
+    static constexpr bool bounded = true;
+
+    /** capacity used by the default constructor. */
+    static constexpr std::size_t default_capacity = 65536;
+
+private:
+    /** a slot of the ring buffer. */
+    struct cell
+    {
+        /** the sequence number tells producers and consumers whether the slot is free or holds data for a given position. */
+        std::atomic_size_t sequence;
+
+        /** storage for an element. */
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        /** access the stored element. */
+        T* get()
+        {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+    };
+
+    /** ring buffer. */
+    std::unique_ptr<cell[]> buffer;
+
+    /** capacity - 1, used to map positions to slots. */
+    std::size_t mask;
+
+    /** next position to write to. */
+    alignas(cache_line_size) std::atomic_size_t enqueue_pos{0};
+
+    /** next position to read from. */
+    alignas(cache_line_size) std::atomic_size_t dequeue_pos{0};
+
+    /** round up to the next power of two. */
+    static std::size_t round_up_capacity(std::size_t capacity)
+    {
+        std::size_t result = 2;
+        while(result < capacity)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+public:
+    /** constructor. */
+    explicit mpmc_bounded_queue(std::size_t capacity = default_capacity)
+    : buffer{std::make_unique<cell[]>(round_up_capacity(capacity))}
+    , mask{round_up_capacity(capacity) - 1}
+    {
+        for(std::size_t i = 0; i <= mask; ++i)
+        {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /** copy construction may be possible, but is disabled for now. */
+    mpmc_bounded_queue(const mpmc_bounded_queue&) = delete;
+
+    /** destructor. */
+    ~mpmc_bounded_queue()
+    {
+        clear();
+    }
+
+    /** try to construct an element in-place. returns false if the queue is full. non-blocking, thread-safe. */
+    template<typename... Args>
+    bool try_emplace(Args&&... args)
+    {
+        cell* c;
+        auto pos = enqueue_pos.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            c = &buffer[pos & mask];
+            auto seq = c->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+            if(diff == 0)
+            {
+                // the slot is free. try to claim it.
+                if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if(diff < 0)
+            {
+                // the slot still holds an element from the previous round, i.e., the queue is full.
+                return false;
+            }
+            else
+            {
+                // another producer claimed the slot.
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        ::new(c->storage) T(std::forward<Args>(args)...);
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** try to push an element. returns false if the queue is full. non-blocking, thread-safe. */
+    bool try_push(const T& f)
+    {
+        return try_emplace(f);
+    }
+
+    /** try to move an element into the container. returns false if the queue is full. non-blocking, thread-safe. */
+    bool try_push(T&& f)
+    {
+        return try_emplace(std::move(f));
+    }
+
+    /** construct an element in-place. spins while the queue is full. thread-safe. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        while(!try_emplace(std::forward<Args>(args)...))
+        {
+            cpu_pause();
+        }
+    }
+
+    /** push an element into the container. spins while the queue is full. thread-safe. */
+    void push(const T& f)
+    {
+        emplace(f);
+    }
+
+    /** move an element into the container. spins while the queue is full. thread-safe. */
+    void push(T&& f)
+    {
+        emplace(std::move(f));
+    }
+
+    /** push a range of elements into the container. spins while the queue is full. thread-safe. */
+    template<typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first)
+        {
+            emplace(*first);
+        }
+    }
+
+    /** try to pop an element off the container. non-blocking, thread-safe. */
+    bool try_pop(T& f)
+    {
+        cell* c;
+        auto pos = dequeue_pos.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            c = &buffer[pos & mask];
+            auto seq = c->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+
+            if(diff == 0)
+            {
+                // the slot holds an element. try to claim it.
+                if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if(diff < 0)
+            {
+                // the slot was not written yet, i.e., the queue is empty.
+                return false;
+            }
+            else
+            {
+                // another consumer claimed the slot.
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        auto element = c->get();
+        f = std::move(*element);
+        element->~T();
+
+        // mark the slot as free for the next round.
+        c->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** try to pop up to max_n elements off the container. returns the number of popped elements. each element is claimed separately. non-blocking, thread-safe. */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        std::size_t count = 0;
+        T f;
+        while(count < max_n && try_pop(f))
+        {
+            *out++ = std::move(f);
+            ++count;
+        }
+
+        return count;
+    }
+
+    /** clear container by popping all elements. non-blocking, thread-safe. */
+    void clear()
+    {
+        T f;
+        while(try_pop(f))
+        {
+        }
+    }
+
+    /** check if the container is possibly empty. non-blocking, thread-safe. */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /** return (approximate) size. non-blocking, thread-safe. */
+    std::size_t size() const
+    {
+        auto read = dequeue_pos.load();
+        auto write = enqueue_pos.load();
+        if(read < write)
+        {
+            return write - read;
+        }
+
+        return 0;
+    }
+
+    /** return the capacity. */
+    std::size_t capacity() const
+    {
+        return mask + 1;
+    }
+};
+
+}    // namespace concurrency_utils
@@ -0,0 +1,440 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * unbounded multiple producer (synchronized, non-blocking), multiple consumer (synchronized, non-blocking) queue.
+ * lock-free linked list of fixed-size segments, indexed by fetch-and-add, in the style of the FAA array queue.
+ * segments are recycled through a free list, using epoch-based reclamation.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "../common.h"
+#include "../epoch.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * unbounded multiple producer multiple consumer queue. elements are stored in segments of segment_size slots. producers
+ * and consumers claim slots with a single fetch-and-add on the segment's indices, and move to the next segment once
+ * the current one is used up.
+ *
+ * used-up segments are unlinked by the consumers and put on a free list, from where producers take them again once no
+ * thread can access them anymore. in the steady state, i.e., once the queue grew to its working size, pushing and popping
+ * does not allocate. only the (rare) segment turnover takes a short lock.
+ *
+ * a consumer that overtakes a producer, i.e., claims a slot which was not written yet, invalidates the slot, and the
+ * producer retries with another slot. so slots may be skipped under contention.
+ */
+template<typename T, std::size_t segment_size = 1024>
+class mpmc_segmented_queue
+{
+    static_assert(segment_size > 1, "mpmc_segmented_queue: segments need at least two slots.");
+
+public:
+    /** type of the stored elements. */
+    using value_type = T;
+
+    /** elements can be pushed while consumers pop. */
+    static constexpr bool concurrent_push_pop = true;
+
+private:
+    /** slot states. */
+    enum slot_state : std::uint32_t
+    {
+        slot_empty = 0,  /** not written yet. */
+        slot_full = 1,   /** holds an element. */
+        slot_taken = 2   /** popped, or invalidated by a consumer that overtook the producer. */
+    };
+
+    /** a slot. slots are padded to separate cache lines, like the cells of mpmc_bounded_queue. */
+    struct alignas(cache_line_size) slot
+    {
+        /** the slot's state. */
+        std::atomic_uint32_t state{slot_empty};
+
+        /** storage for an element. */
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        /** access the stored element. */
+        T* get()
+        {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+    };
+
+    /** a segment of the queue. */
+    struct segment
+    {
+        /** next slot to write to. may exceed segment_size once the segment is full. */
+        alignas(cache_line_size) std::atomic_size_t enqueue_index{0};
+
+        /** next slot to read from. may exceed segment_size once the segment is used up. */
+        alignas(cache_line_size) std::atomic_size_t dequeue_index{0};
+
+        /** the next segment. */
+        alignas(cache_line_size) std::atomic<segment*> next{nullptr};
+
+        /** position of the first slot in the queue, used for size(). */
+        std::size_t base{0};
+
+        /** epoch tag set when the segment was unlinked. */
+        std::uint64_t retire_epoch{0};
+
+        /** the slots. */
+        slot slots[segment_size];
+
+        /** prepare a recycled segment for reuse. */
+        void reset(std::size_t in_base)
+        {
+            enqueue_index.store(0, std::memory_order_relaxed);
+            dequeue_index.store(0, std::memory_order_relaxed);
+            next.store(nullptr, std::memory_order_relaxed);
+            base = in_base;
+            for(auto& it: slots)
+            {
+                it.state.store(slot_empty, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    /** the segment consumers pop from. */
+    alignas(cache_line_size) std::atomic<segment*> head;
+
+    /** the segment producers push to. */
+    alignas(cache_line_size) std::atomic<segment*> tail;
+
+    /** protects the free and retired lists. */
+    alignas(cache_line_size) mutable std::mutex segment_mutex;
+
+    /** segments ready for reuse. */
+    std::vector<segment*> free_segments;
+
+    /** unlinked segments which may still be accessed by other threads. */
+    std::vector<segment*> retired_segments;
+
+    /** number of allocated segments. */
+    std::size_t allocated_segments{0};
+
+    /** the reclamation domain. */
+    detail::epoch_domain& domain{detail::epoch_domain::instance()};
+
+    /** take a segment from the free list, or allocate one. */
+    segment* acquire_segment(std::size_t base)
+    {
+        segment* s = nullptr;
+        {
+            std::unique_lock lock{segment_mutex};
+            if(free_segments.empty() && !retired_segments.empty())
+            {
+                // move all segments which cannot be accessed anymore to the free list.
+                auto oldest = domain.oldest_epoch();
+                auto it = retired_segments.begin();
+                while(it != retired_segments.end())
+                {
+                    if(detail::epoch_domain::is_safe((*it)->retire_epoch, oldest))
+                    {
+                        free_segments.push_back(*it);
+                        it = retired_segments.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+
+            if(!free_segments.empty())
+            {
+                s = free_segments.back();
+                free_segments.pop_back();
+            }
+            else
+            {
+                ++allocated_segments;
+            }
+        }
+
+        if(s == nullptr)
+        {
+            s = new segment;
+        }
+        s->reset(base);
+        return s;
+    }
+
+    /** hand back a segment which was never published. */
+    void release_segment(segment* s)
+    {
+        std::unique_lock lock{segment_mutex};
+        free_segments.push_back(s);
+    }
+
+    /** retire an unlinked segment. */
+    void retire_segment(segment* s)
+    {
+        std::unique_lock lock{segment_mutex};
+        s->retire_epoch = domain.retire();
+        retired_segments.push_back(s);
+    }
+
+    /** move a value into a slot and publish it. returns false if a consumer invalidated the slot, in which case the value is moved back. */
+    static bool try_publish(slot& s, T& value)
+    {
+        ::new(s.storage) T(std::move(value));
+
+        std::uint32_t expected = slot_empty;
+        if(s.state.compare_exchange_strong(expected, slot_full, std::memory_order_release, std::memory_order_relaxed))
+        {
+            return true;
+        }
+
+        value = std::move(*s.get());
+        s.get()->~T();
+        return false;
+    }
+
+    /** destroy the elements of a segment which were not popped. */
+    static void destroy_elements(segment* s)
+    {
+        for(auto& it: s->slots)
+        {
+            if(it.state.load(std::memory_order_relaxed) == slot_full)
+            {
+                it.get()->~T();
+                it.state.store(slot_taken, std::memory_order_relaxed);
+            }
+        }
+    }
+
+public:
+    /** constructor. */
+    mpmc_segmented_queue()
+    {
+        auto s = acquire_segment(0);
+        head.store(s, std::memory_order_relaxed);
+        tail.store(s, std::memory_order_relaxed);
+    }
+
+    /** copy construction may be possible, but is disabled for now. */
+    mpmc_segmented_queue(const mpmc_segmented_queue&) = delete;
+
+    /** destructor. must not be called concurrently with other operations. */
+    ~mpmc_segmented_queue()
+    {
+        for(auto s = head.load(std::memory_order_relaxed); s != nullptr;)
+        {
+            auto next = s->next.load(std::memory_order_relaxed);
+            destroy_elements(s);
+            delete s;
+            s = next;
+        }
+
+        for(auto s: free_segments)
+        {
+            delete s;
+        }
+        for(auto s: retired_segments)
+        {
+            delete s;
+        }
+    }
+
+    /** construct an element and push it into the container. non-blocking, thread-safe. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        T value(std::forward<Args>(args)...);
+
+        detail::epoch_domain::guard g{domain};
+        for(;;)
+        {
+            auto t = tail.load(std::memory_order_seq_cst);
+            auto index = t->enqueue_index.fetch_add(1, std::memory_order_relaxed);
+            if(index < segment_size)
+            {
+                if(try_publish(t->slots[index], value))
+                {
+                    return;
+                }
+                continue;
+            }
+
+            // the segment is full. append a new one, or help a producer which already appended one.
+            if(t != tail.load(std::memory_order_seq_cst))
+            {
+                continue;
+            }
+
+            auto next = t->next.load(std::memory_order_acquire);
+            if(next == nullptr)
+            {
+                auto s = acquire_segment(t->base + segment_size);
+                ::new(s->slots[0].storage) T(std::move(value));
+                s->slots[0].state.store(slot_full, std::memory_order_relaxed);
+                s->enqueue_index.store(1, std::memory_order_relaxed);
+
+                segment* expected = nullptr;
+                if(t->next.compare_exchange_strong(expected, s, std::memory_order_seq_cst))
+                {
+                    tail.compare_exchange_strong(t, s, std::memory_order_seq_cst);
+                    return;
+                }
+
+                // another producer was faster. take the value back.
+                value = std::move(*s->slots[0].get());
+                s->slots[0].get()->~T();
+                s->slots[0].state.store(slot_taken, std::memory_order_relaxed);
+                release_segment(s);
+            }
+            else
+            {
+                tail.compare_exchange_strong(t, next, std::memory_order_seq_cst);
+            }
+        }
+    }
+
+    /** push an element into the container. non-blocking, thread-safe. */
+    void push(const T& f)
+    {
+        emplace(f);
+    }
+
+    /** move an element into the container. non-blocking, thread-safe. */
+    void push(T&& f)
+    {
+        emplace(std::move(f));
+    }
+
+    /** push a range of elements into the container. non-blocking, thread-safe. */
+    template<typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first)
+        {
+            emplace(*first);
+        }
+    }
+
+    /** try to pop an element off the container. non-blocking, thread-safe. */
+    bool try_pop(T& f)
+    {
+        detail::epoch_domain::guard g{domain};
+        for(;;)
+        {
+            auto h = head.load(std::memory_order_seq_cst);
+
+            // check for emptiness first, so that idle consumers do not invalidate slots.
+            if(h->dequeue_index.load(std::memory_order_relaxed) >= h->enqueue_index.load(std::memory_order_relaxed)
+               && h->next.load(std::memory_order_acquire) == nullptr)
+            {
+                return false;
+            }
+
+            auto index = h->dequeue_index.fetch_add(1, std::memory_order_relaxed);
+            if(index < segment_size)
+            {
+                auto& s = h->slots[index];
+                if(s.state.exchange(slot_taken, std::memory_order_acquire) == slot_full)
+                {
+                    f = std::move(*s.get());
+                    s.get()->~T();
+                    return true;
+                }
+
+                // we overtook the producer, which retries with another slot.
+                continue;
+            }
+
+            // the segment is used up. move on to the next segment.
+            auto next = h->next.load(std::memory_order_acquire);
+            if(next == nullptr)
+            {
+                return false;
+            }
+
+            // the tail must not point to an unlinked segment.
+            auto t = h;
+            tail.compare_exchange_strong(t, next, std::memory_order_seq_cst);
+
+            if(head.compare_exchange_strong(h, next, std::memory_order_seq_cst))
+            {
+                retire_segment(h);
+            }
+        }
+    }
+
+    /** try to pop up to max_n elements off the container. returns the number of popped elements. each element is claimed separately. non-blocking, thread-safe. */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        std::size_t count = 0;
+        T f;
+        while(count < max_n && try_pop(f))
+        {
+            *out++ = std::move(f);
+            ++count;
+        }
+
+        return count;
+    }
+
+    /** clear container by popping all elements. non-blocking, thread-safe. */
+    void clear()
+    {
+        T f;
+        while(try_pop(f))
+        {
+        }
+    }
+
+    /** check if the container is possibly empty. non-blocking, thread-safe. */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /** return (approximate) size. invalidated slots are counted until they are passed by a consumer. non-blocking, thread-safe. */
+    std::size_t size() const
+    {
+        detail::epoch_domain::guard g{domain};
+
+        auto h = head.load(std::memory_order_seq_cst);
+        auto t = tail.load(std::memory_order_seq_cst);
+
+        auto clamp = [](std::size_t index) -> std::size_t
+        {
+            return index < segment_size ? index : segment_size;
+        };
+        auto read = h->base + clamp(h->dequeue_index.load(std::memory_order_relaxed));
+        auto write = t->base + clamp(t->enqueue_index.load(std::memory_order_relaxed));
+        if(read < write)
+        {
+            return write - read;
+        }
+
+        return 0;
+    }
+
+    /** return the number of segments allocated by this queue. stays constant in the steady state. */
+    std::size_t segment_count() const
+    {
+        std::unique_lock lock{segment_mutex};
+        return allocated_segments;
+    }
+};
+
+}    // namespace concurrency_utils
@@ -0,0 +1,261 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * priority queue built from one queue ("lane") per priority level. synchronization is inherited from the lanes.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+
+#include "../common.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * a queue with lane_count priority levels. lane 0 has the highest priority. consumers always pop from the highest-priority
+ * non-empty lane, so an urgent task does not wait for bulk work queued before it. pushes without a priority go into the
+ * lowest-priority lane.
+ *
+ * if aging_interval is non-zero, every aging_interval-th pop serves the lanes in reverse order, so that low-priority
+ * work is not starved while high-priority tasks keep arriving.
+ *
+ * the lanes' thread-safety guarantees apply, e.g. priority_lane_queue<mpmc_blocking_queue<T>> can be pushed to while
+ * consumers are running. consumer indices are forwarded to lanes that support them.
+ */
+template<typename lane_type, std::size_t lane_count = 2, std::size_t aging_interval = 0>
+class priority_lane_queue
+{
+    static_assert(lane_count > 0, "priority_lane_queue: at least one lane is required.");
+
+public:
+    /** type of the stored elements. */
+    using value_type = typename lane_type::value_type;
+
+    /** elements can be pushed while consumers pop if the lanes allow it. */
+    static constexpr bool concurrent_push_pop = detail::is_concurrent_queue<lane_type>::value;
+
+    /** the capacity is fixed if the lanes are bounded. */
+    static constexpr bool bounded = detail::is_bounded_queue<lane_type>::value;
+
+    /** priority of the lowest lane, which is used for pushes without a priority. */
+    static constexpr std::size_t lowest_priority = lane_count - 1;
+
+private:
+    /** one queue per priority level. */
+    std::array<lane_type, lane_count> lanes;
+
+    /** number of pops, used for aging. */
+    alignas(cache_line_size) std::atomic_size_t pops{0};
+
+    /** return the lane for a priority. priorities beyond the lowest lane are clamped. */
+    lane_type& get_lane(std::size_t priority)
+    {
+        return lanes[std::min(priority, lowest_priority)];
+    }
+
+    /** call pop on the non-empty lanes in priority order (or reversed, if aging is due) until it returns a non-zero count. */
+    template<typename Pop>
+    std::size_t pop_lanes(Pop&& pop)
+    {
+        bool reverse = false;
+        if constexpr(aging_interval != 0 && lane_count > 1)
+        {
+            reverse = (pops.fetch_add(1, std::memory_order_relaxed) % aging_interval) == aging_interval - 1;
+        }
+
+        for(std::size_t i = 0; i < lane_count; ++i)
+        {
+            // check for emptiness first, since a failing pop may write to shared state.
+            auto& lane = lanes[reverse ? lowest_priority - i : i];
+            if(!lane.empty())
+            {
+                if(auto count = pop(lane); count > 0)
+                {
+                    return count;
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    /** construct a lane. a prvalue, so that lanes which cannot be moved can be stored in the array. */
+    template<std::size_t, typename... Args>
+    static lane_type make_lane(const Args&... lane_args)
+    {
+        return lane_type{lane_args...};
+    }
+
+    /** construct all lanes with the same arguments. */
+    template<std::size_t... I, typename... Args>
+    static std::array<lane_type, lane_count> make_lanes(std::index_sequence<I...>, const Args&... lane_args)
+    {
+        return {{make_lane<I>(lane_args...)...}};
+    }
+
+public:
+    /** default constructor. */
+    priority_lane_queue() = default;
+
+    /** construct every lane with the given arguments, e.g. the capacity of bounded lanes. */
+    template<typename... Args, typename = std::enable_if_t<(sizeof...(Args) > 0)>>
+    explicit priority_lane_queue(const Args&... lane_args)
+    : lanes{make_lanes(std::make_index_sequence<lane_count>{}, lane_args...)}
+    {
+    }
+
+    /** copy construction may be possible, but is disabled for now. */
+    priority_lane_queue(const priority_lane_queue&) = delete;
+
+    /** set the number of consumers of the lanes. only available if the lanes distinguish their consumers. */
+    template<typename L = lane_type>
+    auto set_consumer_count(std::size_t count) -> decltype(std::declval<L&>().set_consumer_count(count), void())
+    {
+        for(auto& it: lanes)
+        {
+            it.set_consumer_count(count);
+        }
+    }
+
+    /** push an element into the lowest-priority lane. */
+    void push(const value_type& f)
+    {
+        lanes[lowest_priority].push(f);
+    }
+
+    /** move an element into the lowest-priority lane. */
+    void push(value_type&& f)
+    {
+        lanes[lowest_priority].push(std::move(f));
+    }
+
+    /** construct an element in-place in the lowest-priority lane. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        lanes[lowest_priority].emplace(std::forward<Args>(args)...);
+    }
+
+    /** construct an element in-place in the lane of the given priority. 0 is the highest priority. */
+    template<typename... Args>
+    void emplace_with_priority(std::size_t priority, Args&&... args)
+    {
+        get_lane(priority).emplace(std::forward<Args>(args)...);
+    }
+
+    /** try to construct an element in-place in the lowest-priority lane. returns false if the lane is full. only available if the lanes provide try_emplace. */
+    template<typename L = lane_type, typename... Args>
+    auto try_emplace(Args&&... args) -> decltype(std::declval<L&>().try_emplace(std::forward<Args>(args)...))
+    {
+        return lanes[lowest_priority].try_emplace(std::forward<Args>(args)...);
+    }
+
+    /** try to construct an element in-place in the lane of the given priority. returns false if the lane is full. only available if the lanes provide try_emplace. */
+    template<typename L = lane_type, typename... Args>
+    auto try_emplace_with_priority(std::size_t priority, Args&&... args) -> decltype(std::declval<L&>().try_emplace(std::forward<Args>(args)...))
+    {
+        return get_lane(priority).try_emplace(std::forward<Args>(args)...);
+    }
+
+    /** try to push an element into the lowest-priority lane. returns false if the lane is full. only available if the lanes provide try_push. */
+    template<typename L = lane_type>
+    auto try_push(value_type&& f) -> decltype(std::declval<L&>().try_push(std::move(f)))
+    {
+        return lanes[lowest_priority].try_push(std::move(f));
+    }
+
+    /** push a range of elements into the lowest-priority lane. */
+    template<typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        lanes[lowest_priority].push_bulk(first, last);
+    }
+
+    /** try to pop an element off the highest-priority non-empty lane. */
+    bool try_pop(value_type& f)
+    {
+        return pop_lanes([&f](lane_type& lane) -> std::size_t
+                         { return lane.try_pop(f) ? 1 : 0; })
+               != 0;
+    }
+
+    /** try to pop an element off the highest-priority non-empty lane on behalf of a consumer. only available if the lanes distinguish their consumers. */
+    template<typename L = lane_type>
+    auto try_pop(value_type& f, std::size_t consumer_index) -> decltype(std::declval<L&>().try_pop(f, consumer_index))
+    {
+        return pop_lanes([&f, consumer_index](lane_type& lane) -> std::size_t
+                         { return lane.try_pop(f, consumer_index) ? 1 : 0; })
+               != 0;
+    }
+
+    /** try to pop up to max_n elements off the highest-priority non-empty lane. returns the number of popped elements. */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        return pop_lanes([&out, max_n](lane_type& lane) -> std::size_t
+                         { return lane.try_pop_bulk(out, max_n); });
+    }
+
+    /** try to pop up to max_n elements off the highest-priority non-empty lane on behalf of a consumer. only available if the lanes distinguish their consumers. */
+    template<typename OutputIt, typename L = lane_type>
+    auto try_pop_bulk(OutputIt out, std::size_t max_n, std::size_t consumer_index) -> decltype(std::declval<L&>().try_pop_bulk(out, max_n, consumer_index))
+    {
+        return pop_lanes([&out, max_n, consumer_index](lane_type& lane) -> std::size_t
+                         { return lane.try_pop_bulk(out, max_n, consumer_index); });
+    }
+
+    /** clear all lanes. */
+    void clear()
+    {
+        for(auto& it: lanes)
+        {
+            it.clear();
+        }
+    }
+
+    /** check if all lanes are possibly empty. */
+    bool empty() const
+    {
+        for(auto& it: lanes)
+        {
+            if(!it.empty())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /** return the (approximate) total size of all lanes. */
+    std::size_t size() const
+    {
+        std::size_t total{0};
+        for(auto& it: lanes)
+        {
+            total += it.size();
+        }
+
+        return total;
+    }
+
+    /** return the (approximate) size of the lane of the given priority. */
+    std::size_t size(std::size_t priority) const
+    {
+        return lanes[std::min(priority, lowest_priority)].size();
+    }
+};
+
+}    // namespace concurrency_utils
@@ -8,9 +8,13 @@
  * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
  */
 
+#pragma once
+
 // include dependencies
 #include <queue>
 #include <mutex>
+#include <utility>
+#include <algorithm>
 
 namespace concurrency_utils
 {
@@ -19,8 +23,13 @@ namespace concurrency_utils
 template<typename T>
 class spmc_blocking_queue
 {
+public:
+    /** type of the stored elements. */
+    using value_type = T;
+
+private:
     /** read access mutex. */
-    std::mutex queue_mutex;
+    mutable std::mutex queue_mutex;
 
     /** queue data. */
     std::deque<T> data;
@@ -38,6 +47,26 @@ public:
         data.push_back(f);
     }
 
+    /** move an element into the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    void push(T&& f)
+    {
+        data.push_back(std::move(f));
+    }
+
+    /** construct an element in-place at the end of the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        data.emplace_back(std::forward<Args>(args)...);
+    }
+
+    /** push a range of elements into the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    template<typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        data.insert(data.end(), first, last);
+    }
+
     /** try to pop an element off the container. popping elements is only safe when not concurrently modifying the queue otherwise (e.g., using push or clear). blocking, thread-safe. */
     bool try_pop(T& f)
     {
@@ -54,21 +83,39 @@ public:
         return true;
     }
 
+    /** try to pop up to max_n elements off the container while holding the lock once. returns the number of popped elements. popping elements is only safe when not concurrently modifying the queue otherwise (e.g., using push or clear). blocking, thread-safe. */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        std::unique_lock mutex_lock{queue_mutex};
+
+        auto count = std::min(max_n, data.size());
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            *out++ = std::move(data.front());
+            data.pop_front();
+        }
+
+        return count;
+    }
+
     /** clear container immediately. clears need to be done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
     void clear()
     {
         data.clear();
     }
 
-    /** check if the container is possibly empty. non-blocking, not thread-safe. */
+    /** check if the container is possibly empty. safe to call while consumers pop elements. blocking, thread-safe. */
     bool empty() const
     {
+        std::unique_lock lock{queue_mutex};
         return data.empty();
     }
 
-    /** return (approximate) size. non-blocking, not thread-safe. */
+    /** return (approximate) size. safe to call while consumers pop elements. blocking, thread-safe. */
     std::size_t size() const
     {
+        std::unique_lock lock{queue_mutex};
         return data.size();
     }
 };
@@ -8,10 +8,16 @@
  * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
  */
 
+#pragma once
+
 // include dependencies
 #include <vector>
 #include <atomic>
 #include <mutex>
+#include <utility>
+#include <algorithm>
+
+#include "../common.h"
 
 namespace concurrency_utils
 {
@@ -20,11 +26,16 @@ namespace concurrency_utils
 template<typename T>
 class spmc_queue
 {
-    /** next slot for non-blocking read. */
-    std::atomic_uint next_slot{0};
+public:
+    /** type of the stored elements. */
+    using value_type = T;
 
-    /** queue data. */
-    std::vector<T> data;
+private:
+    /** next slot for non-blocking read. written by every consumer, so it gets its own cache line. */
+    alignas(cache_line_size) std::atomic_uint next_slot{0};
+
+    /** queue data. the vector's pointer and size are read by every consumer. */
+    alignas(cache_line_size) std::vector<T> data;
 
 public:
     /** default constructor. */
@@ -39,6 +50,26 @@ public:
         data.push_back(f);
     }
 
+    /** move an element into the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    void push(T&& f)
+    {
+        data.push_back(std::move(f));
+    }
+
+    /** construct an element in-place at the end of the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        data.emplace_back(std::forward<Args>(args)...);
+    }
+
+    /** push a range of elements into the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    template<typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        data.insert(data.end(), first, last);
+    }
+
     /** try to pop an element off the container. popping elements is only safe when not concurrently modifying the queue otherwise (e.g., using push or clear). non-blocking, thread-safe. */
     bool try_pop(T& f)
     {
@@ -51,7 +82,7 @@ public:
          */
         if(read < data.size())
         {
-            f = data[read];
+            f = std::move(data[read]);
             return true;
         }
         else
@@ -64,6 +95,55 @@ public:
         return false;
     }
 
+    /**
+     * try to pop up to max_n elements off the container using a single atomic operation. returns the number of popped elements.
+     * popping elements is only safe when not concurrently modifying the queue otherwise (e.g., using push or clear). non-blocking, thread-safe.
+     */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        auto read = next_slot.fetch_add(max_n);
+
+        // see try_pop for why data.size() is constant here.
+        auto container_size = data.size();
+        if(read >= container_size)
+        {
+            next_slot = container_size;
+            return 0;
+        }
+
+        auto count = std::min<std::size_t>(max_n, container_size - read);
+        if(count < max_n)
+        {
+            // we claimed all remaining elements and then some. avoid uncontrolled growth, as in try_pop.
+            next_slot = container_size;
+        }
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            *out++ = std::move(data[read + i]);
+        }
+
+        return count;
+    }
+
+    /**
+     * remove all remaining elements using a single atomic operation, without moving them out. returns the number of removed elements.
+     * the elements are destroyed by the next clear. discarding is only safe when not concurrently modifying the queue otherwise (e.g., using push or clear). non-blocking, thread-safe.
+     */
+    std::size_t discard()
+    {
+        // see try_pop for why data.size() is constant here.
+        auto container_size = data.size();
+        std::size_t read = next_slot.exchange(container_size);
+        if(read >= container_size)
+        {
+            return 0;
+        }
+
+        return container_size - read;
+    }
+
     /** clear container immediately. clears need to be done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
     void clear()
     {
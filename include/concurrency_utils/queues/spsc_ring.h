@@ -0,0 +1,324 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * bounded single producer (wait-free), single consumer (wait-free) ring buffer.
+ * each side caches the other side's index, so that the shared indices are only read when the cached value runs out.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "../common.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * bounded single producer single consumer ring buffer. the capacity is fixed at construction and rounded up to a power of two.
+ *
+ * the try_* functions are wait-free. the bulk functions transfer as many elements as possible and publish them with a
+ * single store, so the other side sees the whole batch at once. push and pop wait (by spinning, then yielding) for
+ * space or for data, which gives backpressure between two threads.
+ *
+ * either side may close the ring: the producer to signal the end of the data, the consumer to stop the producer.
+ * after closing, pushes fail, and pops return the remaining elements and then fail.
+ *
+ * exactly one thread may push and exactly one thread may pop at a time.
+ */
+template<typename T>
+class spsc_ring
+{
+public:
+    /** type of the stored elements. */
+    using value_type = T;
+
+    /** capacity used by the default constructor. */
+    static constexpr std::size_t default_capacity = 1024;
+
+    /** the capacity is fixed. */
+    static constexpr bool bounded = true;
+
+    /** only one thread may pop at a time, so the ring cannot feed a thread pool. */
+    static constexpr bool single_consumer = true;
+
+private:
+    /** storage for an element. slots are not padded, since producer and consumer work on different parts of the ring. */
+    struct slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        /** access the stored element. */
+        T* get()
+        {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+    };
+
+    /** ring buffer. */
+    std::unique_ptr<slot[]> buffer;
+
+    /** capacity - 1, used to map positions to slots. */
+    std::size_t mask;
+
+    /** next position to write to. written by the producer. */
+    alignas(cache_line_size) std::atomic_size_t tail{0};
+
+    /** the producer's copy of head. */
+    std::size_t cached_head{0};
+
+    /** next position to read from. written by the consumer. */
+    alignas(cache_line_size) std::atomic_size_t head{0};
+
+    /** the consumer's copy of tail. */
+    std::size_t cached_tail{0};
+
+    /** set by close(). */
+    alignas(cache_line_size) std::atomic_bool closed{false};
+
+    /** round up to the next power of two. */
+    static std::size_t round_up_capacity(std::size_t capacity)
+    {
+        std::size_t result = 2;
+        while(result < capacity)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    /** return the number of free slots for the producer. only loads head if the cached value shows less than n free slots. */
+    std::size_t free_slots(std::size_t t, std::size_t n)
+    {
+        auto available = mask + 1 - (t - cached_head);
+        if(available < n)
+        {
+            cached_head = head.load(std::memory_order_acquire);
+            available = mask + 1 - (t - cached_head);
+        }
+        return available;
+    }
+
+    /** return the number of readable slots for the consumer. only loads tail if the cached value shows less than n elements. */
+    std::size_t used_slots(std::size_t h, std::size_t n)
+    {
+        auto available = cached_tail - h;
+        if(available < n)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+            available = cached_tail - h;
+        }
+        return available;
+    }
+
+    /** wait a little. spins first, then gives up the time slice. */
+    static void backoff(std::size_t& rounds)
+    {
+        if(++rounds < 64)
+        {
+            cpu_pause();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+public:
+    /** constructor. */
+    explicit spsc_ring(std::size_t capacity = default_capacity)
+    : buffer{std::make_unique<slot[]>(round_up_capacity(capacity))}
+    , mask{round_up_capacity(capacity) - 1}
+    {
+    }
+
+    /** copy construction may be possible, but is disabled for now. */
+    spsc_ring(const spsc_ring&) = delete;
+
+    /** destructor. */
+    ~spsc_ring()
+    {
+        clear();
+    }
+
+    /** try to construct an element in-place. returns false if the ring is full or closed. wait-free, producer only. */
+    template<typename... Args>
+    bool try_emplace(Args&&... args)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if(closed.load(std::memory_order_relaxed) || free_slots(t, 1) == 0)
+        {
+            return false;
+        }
+
+        ::new(buffer[t & mask].storage) T(std::forward<Args>(args)...);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** try to push an element. returns false if the ring is full or closed. wait-free, producer only. */
+    bool try_push(const T& f)
+    {
+        return try_emplace(f);
+    }
+
+    /** try to move an element into the ring. the element is only moved from on success. wait-free, producer only. */
+    bool try_push(T&& f)
+    {
+        return try_emplace(std::move(f));
+    }
+
+    /** push as many elements of a range as fit and publish them at once. returns the number of pushed elements. wait-free, producer only. */
+    template<typename InputIt>
+    std::size_t try_push_bulk(InputIt first, InputIt last)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if(closed.load(std::memory_order_relaxed))
+        {
+            return 0;
+        }
+
+        const std::size_t n = std::distance(first, last);
+        const auto count = std::min(n, free_slots(t, n));
+        for(std::size_t i = 0; i < count; ++i, ++first)
+        {
+            ::new(buffer[(t + i) & mask].storage) T(*first);
+        }
+
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+    /** push an element, waiting while the ring is full. returns false (without moving from the element) if the ring was closed. producer only. */
+    bool push(T&& f)
+    {
+        std::size_t rounds = 0;
+        while(!try_push(std::move(f)))
+        {
+            if(is_closed())
+            {
+                return false;
+            }
+            backoff(rounds);
+        }
+        return true;
+    }
+
+    /** push an element, waiting while the ring is full. returns false if the ring was closed. producer only. */
+    bool push(const T& f)
+    {
+        T copy{f};
+        return push(std::move(copy));
+    }
+
+    /** try to pop an element off the ring. returns false if the ring is empty. wait-free, consumer only. */
+    bool try_pop(T& f)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if(used_slots(h, 1) == 0)
+        {
+            return false;
+        }
+
+        auto& s = buffer[h & mask];
+        f = std::move(*s.get());
+        s.get()->~T();
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** try to pop up to max_n elements and release their slots at once. returns the number of popped elements. wait-free, consumer only. */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        const auto count = std::min(max_n, used_slots(h, max_n));
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            auto& s = buffer[(h + i) & mask];
+            *out++ = std::move(*s.get());
+            s.get()->~T();
+        }
+
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    /** pop an element, waiting while the ring is empty. returns false once the ring is closed and empty. consumer only. */
+    bool pop(T& f)
+    {
+        std::size_t rounds = 0;
+        while(!try_pop(f))
+        {
+            if(is_closed())
+            {
+                // elements pushed before closing are visible now.
+                return try_pop(f);
+            }
+            backoff(rounds);
+        }
+        return true;
+    }
+
+    /** close the ring. thread-safe. */
+    void close()
+    {
+        closed.store(true, std::memory_order_release);
+    }
+
+    /** check whether the ring was closed. thread-safe. */
+    bool is_closed() const
+    {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    /** destroy all elements and reopen the ring. must not be called concurrently with other operations. */
+    void clear()
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        auto t = tail.load(std::memory_order_relaxed);
+        for(; h != t; ++h)
+        {
+            buffer[h & mask].get()->~T();
+        }
+
+        head.store(t, std::memory_order_relaxed);
+        cached_head = t;
+        cached_tail = t;
+        closed.store(false, std::memory_order_relaxed);
+    }
+
+    /** check if the ring is possibly empty. thread-safe. */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /** return (approximate) size. thread-safe. */
+    std::size_t size() const
+    {
+        auto h = head.load(std::memory_order_acquire);
+        auto t = tail.load(std::memory_order_acquire);
+        return t > h ? t - h : 0;
+    }
+
+    /** return the number of elements the ring can hold. */
+    std::size_t capacity() const
+    {
+        return mask + 1;
+    }
+};
+
+}    // namespace concurrency_utils
@@ -0,0 +1,378 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * single producer (unsynchronized), multiple consumer (synchronized, non-blocking) work-stealing queue.
+ * every consumer owns a Chase-Lev style deque and steals from the other deques once its own deque ran empty.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "../common.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * Chase-Lev style deque. the owner pops from the bottom, other consumers steal from the top.
+ *
+ * in contrast to the original algorithm, elements are only pushed while no consumer accesses the deque,
+ * so the data is stored in a plain vector instead of a growable circular buffer.
+ */
+template<typename T>
+class work_stealing_deque
+{
+    /** index of the first element. thieves steal from here. */
+    alignas(cache_line_size) std::atomic<std::ptrdiff_t> top{0};
+
+    /** one past the index of the last element. the owner pops from here. */
+    alignas(cache_line_size) std::atomic<std::ptrdiff_t> bottom{0};
+
+    /** deque data. */
+    alignas(cache_line_size) std::vector<T> data;
+
+public:
+    /** default constructor. */
+    work_stealing_deque() = default;
+
+    /** copy construction may be possible, but is disabled for now. */
+    work_stealing_deque(const work_stealing_deque&) = delete;
+
+    /** push an element to the bottom of the deque. pushes need to done sequentially while not concurrently modifying the deque. non-blocking, not thread-safe. */
+    void push(const T& f)
+    {
+        // elements behind bottom have already been popped by the owner.
+        data.erase(data.begin() + bottom.load(), data.end());
+        data.push_back(f);
+
+        // the atomic store needs to happen after the non-atomic data.push_back() to have a memory barrier.
+        bottom = data.size();
+    }
+
+    /** move an element to the bottom of the deque. pushes need to done sequentially while not concurrently modifying the deque. non-blocking, not thread-safe. */
+    void push(T&& f)
+    {
+        data.erase(data.begin() + bottom.load(), data.end());
+        data.push_back(std::move(f));
+        bottom = data.size();
+    }
+
+    /** construct an element in-place at the bottom of the deque. pushes need to done sequentially while not concurrently modifying the deque. non-blocking, not thread-safe. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        data.erase(data.begin() + bottom.load(), data.end());
+        data.emplace_back(std::forward<Args>(args)...);
+        bottom = data.size();
+    }
+
+    /** pop an element from the bottom. only to be called by the owner of the deque. non-blocking, thread-safe with respect to steal. */
+    bool pop(T& f)
+    {
+        auto b = bottom.load() - 1;
+        bottom = b;
+        auto t = top.load();
+
+        if(t > b)
+        {
+            // the deque was empty. restore bottom.
+            bottom = t;
+            return false;
+        }
+
+        if(t == b)
+        {
+            // this is the last element, so we compete with the thieves.
+            bool success = top.compare_exchange_strong(t, t + 1);
+            bottom = b + 1;
+
+            if(!success)
+            {
+                return false;
+            }
+        }
+
+        f = std::move(data[b]);
+        return true;
+    }
+
+    /** steal an element from the top. may fail spuriously if other consumers access the deque concurrently. non-blocking, thread-safe. */
+    bool steal(T& f)
+    {
+        auto t = top.load();
+        auto b = bottom.load();
+
+        if(t >= b)
+        {
+            return false;
+        }
+
+        // the element at index t is ours if we can advance top.
+        if(!top.compare_exchange_strong(t, t + 1))
+        {
+            return false;
+        }
+
+        f = std::move(data[t]);
+        return true;
+    }
+
+    /** clear deque immediately. clears need to be done sequentially while not concurrently modifying the deque. non-blocking, not thread-safe. */
+    void clear()
+    {
+        data.clear();
+
+        // the atomic stores need to happen after the non-atomic data.clear() to have a memory barrier.
+        top = 0;
+        bottom = 0;
+    }
+
+    /** return (approximate) size. non-blocking, thread-safe. */
+    std::size_t size() const
+    {
+        auto t = top.load();
+        auto b = bottom.load();
+        if(t < b)
+        {
+            return b - t;
+        }
+
+        return 0;
+    }
+};
+
+/**
+ * work-stealing queue. elements are distributed round-robin over one deque per consumer. consumers pop
+ * from their own deque and steal from their neighbours once it is empty, so they do not compete for a
+ * single shared index.
+ */
+template<typename T>
+class work_stealing_queue
+{
+public:
+    /** type of the stored elements. */
+    using value_type = T;
+
+private:
+    /** one deque per consumer. */
+    std::vector<work_stealing_deque<T>> deques;
+
+    /** the deque the next element is pushed into. */
+    std::size_t next_deque{0};
+
+public:
+    /** default constructor. creates a single deque. */
+    work_stealing_queue()
+    : deques(1)
+    {
+    }
+
+    /** copy construction may be possible, but is disabled for now. */
+    work_stealing_queue(const work_stealing_queue&) = delete;
+
+    /** set the number of consumers and clear the queue. non-blocking, not thread-safe. */
+    void set_consumer_count(std::size_t count)
+    {
+        deques = std::vector<work_stealing_deque<T>>(std::max<std::size_t>(count, 1));
+        next_deque = 0;
+    }
+
+    /** return the number of consumers. */
+    std::size_t get_consumer_count() const
+    {
+        return deques.size();
+    }
+
+    /** push an element into the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    void push(const T& f)
+    {
+        deques[next_deque].push(f);
+
+        if(++next_deque == deques.size())
+        {
+            next_deque = 0;
+        }
+    }
+
+    /** move an element into the container. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    void push(T&& f)
+    {
+        deques[next_deque].push(std::move(f));
+
+        if(++next_deque == deques.size())
+        {
+            next_deque = 0;
+        }
+    }
+
+    /** construct an element in-place. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        deques[next_deque].emplace(std::forward<Args>(args)...);
+
+        if(++next_deque == deques.size())
+        {
+            next_deque = 0;
+        }
+    }
+
+    /**
+     * try to pop an element off the consumer's own deque, and steal from the other deques if it is empty.
+     * popping elements is only safe when not concurrently modifying the queue otherwise (e.g., using push or clear).
+     * each consumer index may only be used by one thread at a time. non-blocking, thread-safe.
+     */
+    bool try_pop(T& f, std::size_t consumer_index)
+    {
+        const auto count = deques.size();
+        consumer_index %= count;
+
+        if(deques[consumer_index].pop(f))
+        {
+            return true;
+        }
+
+        // steal from the neighbours.
+        for(std::size_t i = 1; i < count; ++i)
+        {
+            auto victim = consumer_index + i;
+            if(victim >= count)
+            {
+                victim -= count;
+            }
+
+            if(deques[victim].steal(f))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** try to steal an element from any deque. popping elements is only safe when not concurrently modifying the queue otherwise (e.g., using push or clear). non-blocking, thread-safe. */
+    bool try_pop(T& f)
+    {
+        for(auto& it: deques)
+        {
+            if(it.steal(f))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** push a range of elements into the container, distributing them round-robin. pushes need to done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    template<typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first)
+        {
+            emplace(*first);
+        }
+    }
+
+    /**
+     * try to pop up to max_n elements off the consumer's own deque. if it is empty, steal up to max_n elements from the first non-empty neighbour.
+     * returns the number of popped elements. each consumer index may only be used by one thread at a time. non-blocking, thread-safe.
+     */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n, std::size_t consumer_index)
+    {
+        const auto count = deques.size();
+        consumer_index %= count;
+
+        std::size_t popped = 0;
+        T f;
+        while(popped < max_n && deques[consumer_index].pop(f))
+        {
+            *out++ = std::move(f);
+            ++popped;
+        }
+
+        for(std::size_t i = 1; i < count && popped == 0; ++i)
+        {
+            auto victim = consumer_index + i;
+            if(victim >= count)
+            {
+                victim -= count;
+            }
+
+            while(popped < max_n && deques[victim].steal(f))
+            {
+                *out++ = std::move(f);
+                ++popped;
+            }
+        }
+
+        return popped;
+    }
+
+    /** try to steal up to max_n elements from any deque. returns the number of popped elements. non-blocking, thread-safe. */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt out, std::size_t max_n)
+    {
+        std::size_t popped = 0;
+        T f;
+        for(auto& it: deques)
+        {
+            while(popped < max_n && it.steal(f))
+            {
+                *out++ = std::move(f);
+                ++popped;
+            }
+        }
+
+        return popped;
+    }
+
+    /** clear container immediately. clears need to be done sequentially while not concurrently modifying the queue. non-blocking, not thread-safe. */
+    void clear()
+    {
+        for(auto& it: deques)
+        {
+            it.clear();
+        }
+        next_deque = 0;
+    }
+
+    /** check if the container is possibly empty. non-blocking, thread-safe. */
+    bool empty() const
+    {
+        for(auto& it: deques)
+        {
+            if(it.size() != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /** return (approximate) size. non-blocking, thread-safe. */
+    std::size_t size() const
+    {
+        std::size_t total{0};
+        for(auto& it: deques)
+        {
+            total += it.size();
+        }
+
+        return total;
+    }
+};
+
+}    // namespace concurrency_utils
@@ -0,0 +1,375 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * opt-in statistics for the thread pool. define CONCURRENCY_UTILS_STATS before including the library to enable them.
+ * without the define, all recording functions are empty and the snapshots contain no data.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+namespace concurrency_utils
+{
+
+/** whether statistics are recorded. */
+#if defined(CONCURRENCY_UTILS_STATS)
+constexpr bool stats_enabled = true;
+#else
+constexpr bool stats_enabled = false;
+#endif
+
+/** statistics of a worker thread. */
+struct worker_stats
+{
+    /** number of executed tasks. */
+    std::uint64_t tasks_executed{0};
+
+    /** number of pop attempts which did not return a task. */
+    std::uint64_t failed_pops{0};
+
+    /** time spent waiting for the pool to be started, in nanoseconds. */
+    std::uint64_t wait_ns{0};
+
+    /** time spent running tasks, in nanoseconds. */
+    std::uint64_t busy_ns{0};
+};
+
+/** histogram of the time between pushing a task and starting it. bucket i counts latencies in [2^i, 2^(i+1)) nanoseconds, bucket 0 also counts 0. */
+struct latency_histogram
+{
+    /** number of buckets. latencies beyond the last bucket are counted in the last bucket. */
+    static constexpr std::size_t bucket_count = 40;
+
+    /** the buckets. */
+    std::array<std::uint64_t, bucket_count> buckets{};
+
+    /** number of recorded latencies. */
+    std::uint64_t count{0};
+
+    /** sum of all recorded latencies, in nanoseconds. */
+    std::uint64_t total_ns{0};
+
+    /** return the upper bound (in nanoseconds) of the bucket holding the given quantile, e.g. 0.99. returns 0 for an empty histogram. */
+    std::uint64_t quantile_upper_bound(double q) const
+    {
+        if(count == 0)
+        {
+            return 0;
+        }
+
+        const auto target = static_cast<std::uint64_t>(q * static_cast<double>(count));
+        std::uint64_t seen = 0;
+        for(std::size_t i = 0; i < bucket_count; ++i)
+        {
+            seen += buckets[i];
+            if(seen > target || seen == count)
+            {
+                return std::uint64_t{2} << i;
+            }
+        }
+
+        return std::uint64_t{2} << (bucket_count - 1);
+    }
+};
+
+/** a snapshot of the statistics of a thread pool. */
+struct pool_stats
+{
+    /** statistics per worker. */
+    std::vector<worker_stats> workers;
+
+    /** push-to-start latencies per task queue. */
+    std::vector<latency_histogram> queues;
+
+    /** push-to-start latencies of the tasks spawned into task groups. */
+    latency_histogram spawned;
+};
+
+namespace detail
+{
+
+/** clock used for the statistics. */
+using stats_clock = std::chrono::steady_clock;
+
+#if defined(CONCURRENCY_UTILS_STATS)
+
+/** measures the time since its construction. */
+class stats_timer
+{
+    /** start time. */
+    stats_clock::time_point start{stats_clock::now()};
+
+public:
+    /** return the elapsed time in nanoseconds. */
+    std::uint64_t elapsed_ns() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(stats_clock::now() - start).count();
+    }
+};
+
+/** counters of a worker. only written by the worker, so relaxed loads and stores suffice. padded, since snapshots read them from other threads. */
+class alignas(cache_line_size) worker_counters
+{
+    std::atomic_uint64_t tasks_executed{0};
+    std::atomic_uint64_t failed_pops{0};
+    std::atomic_uint64_t wait_ns{0};
+    std::atomic_uint64_t busy_ns{0};
+
+    /** increment a counter owned by the calling thread. */
+    static void add(std::atomic_uint64_t& counter, std::uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+public:
+    void add_executed(std::uint64_t n)
+    {
+        add(tasks_executed, n);
+    }
+
+    void add_failed_pop()
+    {
+        add(failed_pops, 1);
+    }
+
+    void add_wait(std::uint64_t ns)
+    {
+        add(wait_ns, ns);
+    }
+
+    void add_busy(std::uint64_t ns)
+    {
+        add(busy_ns, ns);
+    }
+
+    /** read the counters. */
+    worker_stats snapshot() const
+    {
+        return {tasks_executed.load(std::memory_order_relaxed), failed_pops.load(std::memory_order_relaxed),
+                wait_ns.load(std::memory_order_relaxed), busy_ns.load(std::memory_order_relaxed)};
+    }
+
+    /** reset the counters. only safe while the worker is idle. */
+    void reset()
+    {
+        tasks_executed = 0;
+        failed_pops = 0;
+        wait_ns = 0;
+        busy_ns = 0;
+    }
+};
+
+/** latency histogram of a queue. written by all workers. */
+class alignas(cache_line_size) latency_recorder
+{
+    std::array<std::atomic_uint64_t, latency_histogram::bucket_count> buckets{};
+    std::atomic_uint64_t count{0};
+    std::atomic_uint64_t total_ns{0};
+
+public:
+    /** record a latency. */
+    void record(std::uint64_t ns)
+    {
+        std::size_t bucket = 0;
+        while(ns >> (bucket + 1) && bucket + 1 < latency_histogram::bucket_count)
+        {
+            ++bucket;
+        }
+
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    /** read the histogram. */
+    latency_histogram snapshot() const
+    {
+        latency_histogram h;
+        for(std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+        {
+            h.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        }
+        h.count = count.load(std::memory_order_relaxed);
+        h.total_ns = total_ns.load(std::memory_order_relaxed);
+        return h;
+    }
+
+    /** reset the histogram. */
+    void reset()
+    {
+        for(auto& it: buckets)
+        {
+            it = 0;
+        }
+        count = 0;
+        total_ns = 0;
+    }
+};
+
+/** the histogram the calling worker records latencies into, i.e., the histogram of the queue the current tasks were popped from. */
+inline thread_local latency_recorder* current_latency_recorder = nullptr;
+
+/** selects the histogram the calling thread records latencies into, and restores the previous one when it goes out of scope. */
+class latency_recorder_scope
+{
+    /** the histogram selected before. */
+    latency_recorder* previous{current_latency_recorder};
+
+public:
+    /** constructor. */
+    latency_recorder_scope() = default;
+
+    /** disable copying. */
+    latency_recorder_scope(const latency_recorder_scope&) = delete;
+    latency_recorder_scope& operator=(const latency_recorder_scope&) = delete;
+
+    /** restore the previous histogram. */
+    ~latency_recorder_scope()
+    {
+        current_latency_recorder = previous;
+    }
+
+    /** record the latencies of the following tasks into a histogram. */
+    void select(latency_recorder* recorder)
+    {
+        current_latency_recorder = recorder;
+    }
+};
+
+/** wrap a task so that it records the time between its creation and its invocation. */
+template<typename F>
+auto make_timed_task(F&& f)
+{
+    return [pushed = stats_clock::now(), f = std::forward<F>(f)]() mutable
+    {
+        if(auto recorder = current_latency_recorder)
+        {
+            recorder->record(std::chrono::duration_cast<std::chrono::nanoseconds>(stats_clock::now() - pushed).count());
+        }
+        f();
+    };
+}
+
+#else
+
+/** no-op timer. */
+class stats_timer
+{
+public:
+    std::uint64_t elapsed_ns() const
+    {
+        return 0;
+    }
+};
+
+/** no-op worker counters. */
+class worker_counters
+{
+public:
+    void add_executed(std::uint64_t)
+    {
+    }
+
+    void add_failed_pop()
+    {
+    }
+
+    void add_wait(std::uint64_t)
+    {
+    }
+
+    void add_busy(std::uint64_t)
+    {
+    }
+
+    worker_stats snapshot() const
+    {
+        return {};
+    }
+
+    void reset()
+    {
+    }
+};
+
+/** no-op latency histogram. */
+class latency_recorder
+{
+public:
+    void record(std::uint64_t)
+    {
+    }
+
+    latency_histogram snapshot() const
+    {
+        return {};
+    }
+
+    void reset()
+    {
+    }
+};
+
+/** no histogram to select. */
+class latency_recorder_scope
+{
+public:
+    void select(latency_recorder*)
+    {
+    }
+};
+
+#endif
+
+/**
+ * check whether a task type can hold a callable of type F. task types with an unconstrained converting constructor
+ * (such as inplace_task) report it through a can_store member; for all others, construction is checked.
+ */
+template<typename task_type, typename F, typename = void>
+struct can_hold_task : std::is_constructible<task_type, F>
+{
+};
+
+template<typename task_type, typename F>
+struct can_hold_task<task_type, F, std::void_t<decltype(task_type::template can_store<F>)>> : std::bool_constant<task_type::template can_store<F>>
+{
+};
+
+/**
+ * wrap a task for latency recording, if statistics are enabled and the task type can hold the wrapper. otherwise,
+ * the task is forwarded unchanged (e.g. for queues of std::coroutine_handle<>, or an inplace_task which has no room
+ * for the timestamp), and its latency is not recorded.
+ */
+template<typename task_type, typename F>
+decltype(auto) make_task(F&& f)
+{
+#if defined(CONCURRENCY_UTILS_STATS)
+    if constexpr(can_hold_task<task_type, decltype(make_timed_task(std::forward<F>(f)))>::value)
+    {
+        return make_timed_task(std::forward<F>(f));
+    }
+    else
+#endif
+    {
+        return std::forward<F>(f);
+    }
+}
+
+} /* namespace detail */
+
+} /* namespace concurrency_utils */
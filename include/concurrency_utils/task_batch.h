@@ -0,0 +1,137 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * a recorded list of tasks, which can be replayed on a deferred_thread_pool without pushing the tasks again.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * a batch of tasks, recorded once and run any number of times. running the batch does not copy, move or destroy the
+ * tasks: the pool's workers claim ranges of the task list through a shared cursor (like spmc_queue::next_slot), which
+ * is reset at the start of every run. the storage is kept until the batch is cleared or destroyed.
+ *
+ * the tasks are called through a non-const reference and have to be callable repeatedly.
+ *
+ * a batch must not be modified or run concurrently with another run of the same batch.
+ */
+template<typename task_type = std::function<void()>>
+class task_batch
+{
+    /** the recorded tasks. */
+    std::vector<task_type> tasks;
+
+    /** next task to claim during a run. written by every worker, so it gets its own cache line. */
+    alignas(cache_line_size) std::atomic_size_t cursor{0};
+
+    /** number of tasks claimed at once. */
+    std::size_t claim_size{1};
+
+    /** executed by the pool's workers. claims tasks until the batch is exhausted, and runs each through invoke. */
+    template<typename Invoke>
+    void runner(Invoke& invoke)
+    {
+        const auto count = tasks.size();
+        for(auto first = cursor.fetch_add(claim_size, std::memory_order_relaxed); first < count; first = cursor.fetch_add(claim_size, std::memory_order_relaxed))
+        {
+            const auto last = std::min(first + claim_size, count);
+            for(auto i = first; i < last; ++i)
+            {
+                invoke(tasks[i]);
+            }
+        }
+    }
+
+public:
+    /** default constructor creates an empty batch. */
+    task_batch() = default;
+
+    /** disable copying. */
+    task_batch(const task_batch&) = delete;
+    task_batch& operator=(const task_batch&) = delete;
+
+    /** record a task. */
+    template<typename F>
+    void add(F&& task)
+    {
+        tasks.emplace_back(std::forward<F>(task));
+    }
+
+    /** reserve storage for a number of tasks. */
+    void reserve(std::size_t count)
+    {
+        tasks.reserve(count);
+    }
+
+    /** remove all tasks. the storage is kept for recording a new batch. */
+    void clear()
+    {
+        tasks.clear();
+    }
+
+    /** return the number of recorded tasks. */
+    std::size_t size() const
+    {
+        return tasks.size();
+    }
+
+    /** check whether the batch has no tasks. */
+    bool empty() const
+    {
+        return tasks.empty();
+    }
+
+    /** return the number of tasks the storage can hold without reallocating. */
+    std::size_t capacity() const
+    {
+        return tasks.capacity();
+    }
+
+    /**
+     * run all tasks of the batch on a pool and wait for them to finish. called by deferred_thread_pool::run(batch).
+     *
+     * as parallel_for, this runs (and waits for) the pool's whole task queue. one runner task is pushed per worker, and
+     * every runner claims a few tasks at once, so that the cursor is not touched for every task. every task is run through
+     * invoke(task), which must not throw. the pool passes its error handling, so that a throwing task does not end the
+     * runner, and the remaining tasks still run (unless the pool cancels them, see set_cancel_on_error).
+     */
+    template<typename Pool, typename Invoke>
+    void run(Pool& pool, Invoke invoke)
+    {
+        if(tasks.empty())
+        {
+            return;
+        }
+
+        const auto runner_count = std::min(std::max<std::size_t>(pool.get_thread_count(), 1), tasks.size());
+        claim_size = std::max<std::size_t>(tasks.size() / (4 * runner_count), 1);
+        cursor.store(0, std::memory_order_relaxed);
+
+        for(std::size_t i = 0; i < runner_count; ++i)
+        {
+            pool.push_task([this, &invoke]()
+                           { runner(invoke); });
+        }
+
+        pool.run_tasks_and_wait();
+    }
+};
+
+} /* namespace concurrency_utils */
@@ -0,0 +1,315 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * a reusable task dependency graph, executed on a deferred_thread_pool.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "queues/mpmc_bounded.h"
+#include "wait_policy.h"
+
+namespace concurrency_utils
+{
+
+/**
+ * a directed acyclic graph of tasks. nodes and edges are declared once, and the graph can be run any number of times.
+ *
+ * when running the graph, every node is released as soon as its last predecessor finished, i.e., there are no
+ * barriers between "stages" of the graph. the pool's workers execute one runner task each, which take released
+ * nodes off a shared, lock-free ready queue. this works with every queue type of the pool, since the graph never
+ * pushes into the pool's queue while its workers are running.
+ *
+ * a graph must not be modified or run concurrently with another run of the same graph.
+ */
+class task_graph
+{
+public:
+    /** identifies a node. */
+    using node_id = std::size_t;
+
+private:
+    /** a node of the graph. */
+    struct node
+    {
+        /** the node's task. */
+        std::function<void()> work;
+
+        /** nodes depending on this node. */
+        std::vector<node_id> successors;
+
+        /** number of nodes this node depends on. */
+        std::size_t predecessor_count{0};
+    };
+
+    /** the number of unfinished predecessors of a node during a run. padded, since the counters are decremented by different workers. */
+    struct alignas(cache_line_size) predecessor_counter
+    {
+        std::atomic_size_t value{0};
+    };
+
+    /** the nodes. */
+    std::vector<node> nodes;
+
+    /** whether the graph changed since it was last checked for cycles. */
+    bool validated{true};
+
+    /** predecessor counters, one per node. only reallocated when the graph grows. */
+    std::unique_ptr<predecessor_counter[]> counters;
+
+    /** number of allocated counters. */
+    std::size_t counter_count{0};
+
+    /** released nodes. every node is pushed exactly once per run, so the queue never runs full. */
+    std::unique_ptr<mpmc_bounded_queue<node_id>> ready;
+
+    /** number of finished nodes of the current run. */
+    alignas(cache_line_size) std::atomic_size_t finished{0};
+
+    /** runners wait for released nodes or for the end of the run. */
+    alignas(cache_line_size) backoff_wait<> ready_wait;
+
+    /** set by the first failing node of a run. the remaining nodes are skipped. */
+    alignas(cache_line_size) std::atomic_bool failed{false};
+
+    /** the exception of the first failing node. written by the node that set failed. */
+    std::exception_ptr error;
+
+    /** check that the graph has no cycles, using Kahn's algorithm. */
+    void validate()
+    {
+        std::vector<std::size_t> in_degree(nodes.size());
+        std::vector<node_id> stack;
+        for(node_id id = 0; id < nodes.size(); ++id)
+        {
+            in_degree[id] = nodes[id].predecessor_count;
+            if(in_degree[id] == 0)
+            {
+                stack.push_back(id);
+            }
+        }
+
+        std::size_t visited = 0;
+        while(!stack.empty())
+        {
+            auto id = stack.back();
+            stack.pop_back();
+            ++visited;
+
+            for(auto s: nodes[id].successors)
+            {
+                if(--in_degree[s] == 0)
+                {
+                    stack.push_back(s);
+                }
+            }
+        }
+
+        if(visited != nodes.size())
+        {
+            throw std::logic_error("task_graph: the graph contains a cycle.");
+        }
+
+        validated = true;
+    }
+
+    /** set up the counters and the ready queue for a run, and release the nodes without predecessors. */
+    void prepare()
+    {
+        if(counter_count < nodes.size())
+        {
+            counters = std::make_unique<predecessor_counter[]>(nodes.size());
+            counter_count = nodes.size();
+        }
+
+        if(!ready || ready->capacity() < nodes.size())
+        {
+            ready = std::make_unique<mpmc_bounded_queue<node_id>>(nodes.size());
+        }
+
+        finished.store(0, std::memory_order_relaxed);
+        failed.store(false, std::memory_order_relaxed);
+        error = nullptr;
+        for(node_id id = 0; id < nodes.size(); ++id)
+        {
+            counters[id].value.store(nodes[id].predecessor_count, std::memory_order_relaxed);
+            if(nodes[id].predecessor_count == 0)
+            {
+                ready->push(id);
+            }
+        }
+    }
+
+    /** execute a node and release its successors. */
+    void execute(node_id id)
+    {
+        auto& n = nodes[id];
+        if(n.work && !failed.load(std::memory_order_relaxed))
+        {
+            try
+            {
+                n.work();
+            }
+            catch(...)
+            {
+                // keep releasing the successors, so that the run finishes.
+                if(!failed.exchange(true, std::memory_order_relaxed))
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        for(auto s: n.successors)
+        {
+            // the last finished predecessor releases the node.
+            if(counters[s].value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                ready->push(s);
+                ready_wait.notify();
+            }
+        }
+
+        if(finished.fetch_add(1, std::memory_order_acq_rel) + 1 == nodes.size())
+        {
+            ready_wait.notify();
+        }
+    }
+
+    /** executed by the pool's workers. runs released nodes until all nodes finished. */
+    void runner()
+    {
+        const auto count = nodes.size();
+
+        node_id id;
+        while(true)
+        {
+            if(ready->try_pop(id))
+            {
+                execute(id);
+                continue;
+            }
+
+            if(finished.load(std::memory_order_acquire) == count)
+            {
+                break;
+            }
+
+            ready_wait.wait([this, count]() -> bool
+                            { return !ready->empty() || finished.load(std::memory_order_acquire) == count; });
+        }
+    }
+
+public:
+    /** default constructor creates an empty graph. */
+    task_graph() = default;
+
+    /** disable copying. */
+    task_graph(const task_graph&) = delete;
+    task_graph& operator=(const task_graph&) = delete;
+
+    /** add a node and return its id. */
+    template<typename F>
+    node_id add_node(F&& work)
+    {
+        nodes.emplace_back();
+        nodes.back().work = std::forward<F>(work);
+        return nodes.size() - 1;
+    }
+
+    /** add an edge, i.e., declare that the node to runs after the node from finished. */
+    void add_edge(node_id from, node_id to)
+    {
+        if(from >= nodes.size() || to >= nodes.size())
+        {
+            throw std::out_of_range("task_graph: invalid node id.");
+        }
+
+        nodes[from].successors.push_back(to);
+        ++nodes[to].predecessor_count;
+        validated = false;
+    }
+
+    /** declare that the node to runs after all nodes in from finished. */
+    void add_edges(const std::vector<node_id>& from, node_id to)
+    {
+        for(auto it: from)
+        {
+            add_edge(it, to);
+        }
+    }
+
+    /** remove all nodes and edges. */
+    void clear()
+    {
+        nodes.clear();
+        validated = true;
+    }
+
+    /** return the number of nodes. */
+    std::size_t size() const
+    {
+        return nodes.size();
+    }
+
+    /** check whether the graph has no nodes. */
+    bool empty() const
+    {
+        return nodes.empty();
+    }
+
+    /**
+     * run the graph on a pool and wait for all nodes to finish. throws std::logic_error if the graph contains a cycle.
+     * if a node throws, the nodes which did not start yet are skipped, and the exception is rethrown once the run finished.
+     *
+     * as parallel_for, this runs (and waits for) the pool's whole task queue. the runners are pushed as one task
+     * per worker, so a fixed chunk size (see set_chunk_size) larger than 1 may reduce the parallelism.
+     */
+    template<typename Pool>
+    void run(Pool& pool)
+    {
+        if(nodes.empty())
+        {
+            return;
+        }
+
+        if(!validated)
+        {
+            validate();
+        }
+
+        prepare();
+
+        const auto runner_count = std::min(std::max<std::size_t>(pool.get_thread_count(), 1), nodes.size());
+        for(std::size_t i = 0; i < runner_count; ++i)
+        {
+            pool.push_task([this]()
+                           { runner(); });
+        }
+
+        pool.run_tasks_and_wait();
+
+        if(error)
+        {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+};
+
+} /* namespace concurrency_utils */
@@ -8,75 +8,404 @@
  * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
  */
 
+#pragma once
+
 // include dependencies.
 #include <thread>
 #include <mutex>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <exception>
 #include <future>
+#include <stdexcept>
+#include <string>
 #include <functional>
+#include <type_traits>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <memory>
 
+#include "affinity.h"
+#include "arena_task.h"
+#include "cancellation.h"
 #include "queue.h"
+#include "queue_traits.h"
+#include "inplace_task.h"
+#include "future.h"
+#include "wait_policy.h"
+#include "coroutine.h"
+#include "stats.h"
+#include "trace.h"
+#include "task_batch.h"
 
 namespace concurrency_utils
 {
 
+namespace detail
+{
+
+/** number of tasks finished by a worker. only written by the worker, so relaxed loads and stores suffice. padded, since the controlling thread reads it. */
+class alignas(cache_line_size) worker_progress
+{
+    std::atomic_size_t finished{0};
+
+public:
+    void add_finished(std::size_t n)
+    {
+        finished.store(finished.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::size_t get_finished() const
+    {
+        return finished.load(std::memory_order_relaxed);
+    }
+};
+
+/** bind arguments to a callable. the callable and the arguments are forwarded (i.e., moved or copied) into the returned closure. */
+template<typename F, typename... A>
+auto bind_task(F&& task, A&&... args)
+{
+    return [task = std::forward<F>(task), args = std::make_tuple(std::forward<A>(args)...)]() mutable
+    { return std::apply(task, args); };
+}
+
+/** the pool the calling thread is a worker of, or nullptr. used to find the worker's spawn queue. */
+inline thread_local const void* current_pool = nullptr;
+
+/** the calling worker's index in current_pool. */
+inline thread_local std::size_t current_worker_index = 0;
+
+} /* namespace detail */
+
+template<typename queue_type, typename wait_policy>
+class deferred_thread_pool;
+
+/**
+ * a group of child tasks spawned into a pool with spawn(group, f). wait_for(group) waits until all of them finished.
+ * a group can be reused once it is done. it must outlive its tasks.
+ */
+class task_group
+{
+    template<typename, typename>
+    friend class deferred_thread_pool;
+
+    /** number of spawned tasks which did not finish yet. */
+    alignas(cache_line_size) std::atomic_size_t pending{0};
+
+public:
+    /** default constructor. */
+    task_group() = default;
+
+    /** disable copying. */
+    task_group(const task_group&) = delete;
+    task_group& operator=(const task_group&) = delete;
+
+    /** return the number of unfinished tasks. */
+    std::size_t get_pending() const
+    {
+        return pending.load(std::memory_order_acquire);
+    }
+
+    /** check whether all tasks finished. */
+    bool done() const
+    {
+        return get_pending() == 0;
+    }
+};
+
+/** thrown by run_tasks_and_wait if tasks threw exceptions. holds the exceptions of all failed tasks of the run. */
+class task_errors : public std::runtime_error
+{
+    /** the tasks' exceptions, in the order they were caught. */
+    std::vector<std::exception_ptr> errors;
+
+public:
+    /** constructor. */
+    explicit task_errors(std::vector<std::exception_ptr> in_errors)
+    : std::runtime_error{std::to_string(in_errors.size()) + (in_errors.size() == 1 ? " task failed" : " tasks failed")}
+    , errors{std::move(in_errors)}
+    {
+    }
+
+    /** return the tasks' exceptions. */
+    const std::vector<std::exception_ptr>& exceptions() const noexcept
+    {
+        return errors;
+    }
+
+    /** rethrow the first exception. */
+    [[noreturn]] void rethrow_first() const
+    {
+        std::rethrow_exception(errors.front());
+    }
+};
+
+/** the outcome of run_tasks_and_wait_until and run_tasks_and_wait_for. */
+struct run_result
+{
+    /** number of tasks which ran to completion (or threw) during the call. */
+    std::size_t completed{0};
+
+    /** number of tasks which were dropped or skipped, i.e., by the deadline, by cancel_pending, by a cancellation token or by cancel_on_error. */
+    std::size_t cancelled{0};
+
+    /** whether the deadline passed before all tasks finished. */
+    bool timed_out{false};
+};
+
 /**
  * a C++17 thread pool that queues up jobs and (when instructed to do so) executes them by using the threads in the pool.
+ *
+ * the task type is the queue's value_type, e.g. std::function<void()> or inplace_task<capacity>.
+ * the wait policy determines how threads wait for the workers (see wait_policy.h).
+ * the placement of the workers (cpu pinning, NUMA nodes, one queue per node) is set through a pool_config (see affinity.h).
  */
-template<typename queue_type = mpmc_blocking_queue<std::function<void()>>>
+template<typename queue_type = mpmc_blocking_queue<std::function<void()>>, typename wait_policy = backoff_wait<>>
 class deferred_thread_pool
 {
+public:
+    /** task type. */
+    using task_type = typename queue_type::value_type;
+
+    /** properties of the queue. */
+    using traits = queue_traits<queue_type>;
+
+    static_assert(detail::is_pool_queue<queue_type>::value, "deferred_thread_pool: the queue needs value_type, emplace, try_pop, empty, size and clear (see queue_traits.h).");
+    static_assert(traits::is_multi_consumer, "deferred_thread_pool: the queue needs to support multiple consumers.");
+    static_assert(!traits::is_bounded || (traits::has_try_emplace && traits::is_multi_producer), "deferred_thread_pool: pushing into a full bounded queue starts the workers, so bounded queues need try_emplace and to allow pushes while consumers pop.");
+
+private:
+    /*
+     * read-mostly data. only written when creating or resetting the pool.
+     */
+
+    /** creates additional task queues, using the queue arguments passed to the constructor. */
+    using queue_factory = std::function<std::unique_ptr<queue_type>()>;
+
+    /** the configuration the threads were created with. */
+    pool_config config;
+
     /** thread count. */
     std::size_t thread_count{0};
 
+    /** placement of the workers and the queues. */
+    detail::pool_placement placement;
+
     /** threads. */
     std::vector<std::thread> threads;
 
-    /** An atomic variable indicating to the workers to stop. */
-    std::atomic_bool stop{false};
+    /** creates the task queues. */
+    queue_factory make_queue;
 
-    /** task queue. */
-    queue_type tasks;
+    /** number of tasks a worker claims from the queue at once. 0 selects the number adaptively. */
+    std::atomic_size_t chunk_size{0};
 
-    /** mutex for task processing. */
-    mutable std::mutex run_mutex;
+    /** upper bound for adaptively selected chunk sizes. */
+    static constexpr std::size_t max_adaptive_chunk_size = 32;
+
+    /*
+     * flags checked by the workers on every iteration. they are only written when starting or stopping, so they share a cache line.
+     */
 
-    /** condition variable to indicate wheather we should process the submitted tasks. */
-    std::condition_variable should_run;
+    /** An atomic variable indicating to the workers to stop. */
+    alignas(cache_line_size) std::atomic_bool stop{false};
 
     /** whether we should process the tasks in the queue. */
     std::atomic_bool process_tasks{false};
 
+    /** whether the first exception of a run cancels the remaining tasks. */
+    std::atomic_bool cancel_on_error{false};
+
+    /** set if a task failed and cancel_on_error is set. the remaining tasks of the run are skipped. */
+    std::atomic_bool cancelled{false};
+
+    /** number of workers which may run. workers with a larger index were retired by resize and exit. */
+    std::atomic_size_t running_workers{0};
+
+    /** spin rounds of idle workers before parking, see idle_policy. */
+    std::atomic_size_t idle_spin_count{idle_policy{}.spin_count};
+
+    /** spin time limit of idle workers in nanoseconds, see idle_policy. */
+    std::atomic<std::int64_t> idle_spin_ns{idle_policy{}.spin_time.count()};
+
+    /*
+     * data written by different threads. every member starts on its own cache line.
+     */
+
+    /** shared states for futures returned by submit. declared before the task queue, since queued tasks may still reference states. */
+    alignas(cache_line_size) detail::block_pool future_states;
+
+    /** task queues. holds one queue per node if the pool was configured with queue_per_node, and a single queue otherwise. */
+    alignas(cache_line_size) std::vector<std::unique_ptr<queue_type>> queues;
+
+    /** the queue the next task is pushed into, if there are multiple queues. */
+    alignas(cache_line_size) std::atomic_size_t next_queue{0};
+
+    /** incremented on every wake-up, so that spinning workers notice new work without checking the queues. */
+    alignas(cache_line_size) std::atomic<std::uint64_t> wake_epoch{0};
+
     /** keep track of the currently active threads. */
-    std::atomic_size_t active_threads{0};
+    alignas(cache_line_size) std::atomic_size_t active_threads{0};
+
+    /** number of submitted tasks which did not finish yet. */
+    alignas(cache_line_size) std::atomic_size_t pending_tasks{0};
+
+    /** waits for the tasks and the workers to finish. notified by the last finished task and by the last thread going idle. */
+    alignas(cache_line_size) wait_policy completion;
+
+    /** protects errors. */
+    alignas(cache_line_size) std::mutex error_mutex;
+
+    /** exceptions thrown by the tasks of the current run. */
+    std::vector<std::exception_ptr> errors;
+
+    /*
+     * per-worker data. deques keep the elements in place when workers are added or retired, see resize.
+     */
+
+    /** number of finished tasks per worker. */
+    std::deque<detail::worker_progress> progress;
+
+    /** per-worker semaphores for parking idle workers. */
+    std::deque<detail::worker_parker> parkers;
+
+    /** number of tasks finished by threads which are not workers of this pool, i.e., inside wait_for. */
+    alignas(cache_line_size) std::atomic_size_t helped_tasks{0};
+
+    /** number of tasks which were popped, but skipped because they were cancelled. */
+    alignas(cache_line_size) std::atomic_size_t skipped_tasks{0};
+
+    /** number of tasks dropped by cancel_pending. */
+    std::atomic_size_t dropped_tasks{0};
+
+    /** per-worker statistics. empty classes if statistics are disabled. */
+    alignas(cache_line_size) std::deque<detail::worker_counters> counters;
+
+    /** per-queue latency histograms. */
+    std::unique_ptr<detail::latency_recorder[]> queue_latencies;
+
+    /** latency histogram of the spawned tasks, which do not go through the queues. */
+    detail::latency_recorder spawn_latency;
+
+    /** per-worker trace buffers. empty classes if tracing is disabled. */
+    std::deque<detail::trace_buffer> worker_traces;
+
+    /** trace buffer of the thread controlling the pool, i.e., the thread calling start_tasks and run_tasks_and_wait. */
+    detail::trace_buffer control_trace;
+
+    /** queue type for spawned tasks. every worker owns one, and the other workers steal from it. */
+    using spawn_queue_type = mpmc_segmented_queue<task_type, 256>;
+
+    /** per-worker queues for spawned tasks. */
+    std::deque<spawn_queue_type> spawn_queues;
+
+    /** per-worker arenas, see this_worker::arena(). reset at the end of every run. */
+    std::deque<arena> arenas;
+
+    /** the spawn queue used by the next spawn from outside the pool. */
+    alignas(cache_line_size) std::atomic_size_t next_spawn_queue{0};
 
     /*
      * private helpers.
      */
 
-    /** create the worker threads. creates at least one thread. */
+    /** return a factory constructing queues from copies of the given arguments. */
+    template<typename... Args>
+    static queue_factory make_queue_factory(Args&&... queue_args)
+    {
+        return [args = std::make_tuple(std::decay_t<Args>(std::forward<Args>(queue_args))...)]()
+        {
+            return std::apply([](const auto&... a)
+                              { return std::make_unique<queue_type>(a...); },
+                              args);
+        };
+    }
+
+    /** create the worker threads and the queues according to the configuration. creates at least one thread. */
     void create_threads()
     {
-        // create at least one thread.
-        if(!thread_count)
+        placement = detail::make_placement(config);
+        thread_count = placement.workers.size();
+
+        // reuse existing queues and create the missing ones.
+        if(queues.size() > placement.queue_count)
         {
-            thread_count = 1;
+            queues.resize(placement.queue_count);
         }
+        while(queues.size() < placement.queue_count)
+        {
+            queues.emplace_back(make_queue());
+        }
+        next_queue = 0;
 
-        tasks.clear();
+        for(std::size_t q = 0; q < queues.size(); ++q)
+        {
+            queues[q]->clear();
 
-        // allocate threads.
-        threads.reserve(thread_count);
-        for(std::size_t i = 0; i < thread_count; ++i)
+            // queues with per-consumer storage need to know about their workers.
+            if constexpr(traits::has_consumer_index)
+            {
+                queues[q]->set_consumer_count(placement.queue_consumers[q]);
+            }
+        }
+
+        queue_latencies = std::make_unique<detail::latency_recorder[]>(queues.size());
+        spawn_latency.reset();
+
+        resize_worker_data(0);
+        resize_worker_data(thread_count);
+        start_workers(0, thread_count);
+    }
+
+    /** add or remove per-worker data. the data of the other workers stays in place. */
+    void resize_worker_data(std::size_t count)
+    {
+        while(progress.size() > count)
         {
-            threads.emplace_back(&deferred_thread_pool::worker, this);
+            progress.pop_back();
+            parkers.pop_back();
+            counters.pop_back();
+            worker_traces.pop_back();
+            spawn_queues.pop_back();
+            arenas.pop_back();
+        }
+        while(progress.size() < count)
+        {
+            progress.emplace_back();
+            parkers.emplace_back();
+            counters.emplace_back();
+            worker_traces.emplace_back();
+            spawn_queues.emplace_back();
+            arenas.emplace_back();
+        }
+    }
+
+    /** start the workers with indices in [first, last) and wait until they are ready. every thread marks itself as idle once it started. */
+    void start_workers(std::size_t first, std::size_t last)
+    {
+        running_workers = last;
+        active_threads += last - first;
+        threads.reserve(last);
+        for(std::size_t i = first; i < last; ++i)
+        {
+            threads.emplace_back(&deferred_thread_pool::worker, this, i);
         }
 
         // wait for threads to be ready.
-        while(active_threads > 0)
+        completion.wait([this]() -> bool
+                        { return active_threads == 0; });
+    }
+
+    /** mark the calling worker as idle. */
+    void set_idle()
+    {
+        if(--active_threads == 0)
         {
-            std::this_thread::yield();
+            completion.notify();
         }
     }
 
@@ -85,14 +414,10 @@ class deferred_thread_pool
     {
         if(threads.size())
         {
-            run_tasks_and_wait();
-
-            {
-                std::unique_lock lock{run_mutex};
-                stop = true;
+            wait_for_tasks();
 
-                should_run.notify_all();
-            }
+            stop = true;
+            wake_workers(thread_count);
 
             for(auto& it: threads)
             {
@@ -102,183 +427,1235 @@ class deferred_thread_pool
             active_threads = 0;
         }
 
-        tasks.clear();
+        clear_queues();
+        pending_tasks = 0;
+        discard_errors();
     }
 
-    /** worker function. */
-    void worker()
+    /** clear all task queues. */
+    void clear_queues()
     {
-        ++active_threads;
-
-        while(!stop)
+        for(auto& it: queues)
         {
-            --active_threads;
+            it->clear();
+        }
+        for(auto& it: spawn_queues)
+        {
+            it.clear();
+        }
+    }
 
-            // acquire lock.
+    /** check whether all spawn queues are (possibly) empty. */
+    bool spawn_queues_empty() const
+    {
+        for(auto& it: spawn_queues)
+        {
+            if(!it.empty())
             {
-                std::unique_lock run_lock{run_mutex};
-                should_run.wait(run_lock, [&]() -> bool
-                                { return stop || (process_tasks && !tasks.empty()); });
+                return false;
             }
+        }
 
-            // exit if the pool is stopped.
-            if(stop)
-            {
-                break;
-            }
+        return true;
+    }
 
-            ++active_threads;
+    /** return the index of the calling worker, or thread_count if the caller is not a worker of this pool. */
+    std::size_t get_calling_worker() const
+    {
+        return detail::current_pool == this ? detail::current_worker_index : thread_count;
+    }
 
-            // process the tasks assigned to this thread.
-            std::function<void()> task;
-            while(process_tasks && !tasks.empty())
+    /** pop a spawned task. the queue of the worker with the given index is tried first, then the other queues are stolen from. */
+    bool pop_spawned_task(task_type& task, std::size_t worker_index)
+    {
+        for(std::size_t i = 0; i < thread_count; ++i)
+        {
+            if(spawn_queues[(worker_index + i) % thread_count].try_pop(task))
             {
-                if(tasks.try_pop(task))
-                {
-                    // execute task.
-                    task();
-                }
+                return true;
             }
         }
+
+        return false;
     }
 
-public:
-    /** default constructor does not create threads. */
-    deferred_thread_pool()
-    : thread_count{0}
+    /** store the exception of a failed task and cancel the remaining tasks if requested. */
+    void add_error(std::exception_ptr e)
     {
+        {
+            std::unique_lock lock{error_mutex};
+            errors.emplace_back(std::move(e));
+        }
+
+        if(cancel_on_error.load(std::memory_order_relaxed))
+        {
+            cancelled.store(true, std::memory_order_relaxed);
+        }
     }
 
-    /** constructor. */
-    deferred_thread_pool(std::size_t in_thread_count)
-    : thread_count{in_thread_count}
+    /** drop the stored exceptions and the cancellation. */
+    void discard_errors()
     {
-        create_threads();
+        std::unique_lock lock{error_mutex};
+        errors.clear();
+        cancelled = false;
     }
 
-    /** destructor. */
-    ~deferred_thread_pool()
+    /** run a task and store its exception. on the non-throwing path, this costs nothing but the task call. */
+    void invoke_task(task_type& task) noexcept
     {
-        destroy_threads();
+        try
+        {
+            task();
+        }
+        catch(...)
+        {
+            add_error(std::current_exception());
+        }
     }
 
-    /** disable copying. */
-    deferred_thread_pool(const deferred_thread_pool&) = delete;
-    deferred_thread_pool& operator=(const deferred_thread_pool&) = delete;
+    /** run a task from a task queue. the task is skipped if the run was cancelled. */
+    void invoke_queued_task(task_type& task) noexcept
+    {
+        if(!cancelled.load(std::memory_order_relaxed))
+        {
+            invoke_task(task);
+        }
+        else
+        {
+            skipped_tasks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
 
-    /** start submitted tasks and wait for all tasks to be completed. */
-    void run_tasks_and_wait()
+    /** run a task of a task_batch. as for queued tasks, its exception is stored and the task is skipped if the run was cancelled. */
+    template<typename F>
+    void invoke_recorded_task(F& task) noexcept
     {
-        if(tasks.empty())
+        if(cancelled.load(std::memory_order_relaxed))
         {
-            process_tasks = false;
+            skipped_tasks.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
 
-            // threads might still be active.
-            while(active_threads > 0)
-            {
-                std::this_thread::yield();
-            }
+        try
+        {
+            task();
+        }
+        catch(...)
+        {
+            add_error(std::current_exception());
+        }
+    }
 
-            return;
+    /** return the number of tasks finished so far, including skipped tasks. */
+    std::size_t get_finished_tasks() const
+    {
+        auto total = helped_tasks.load(std::memory_order_relaxed);
+        for(auto& it: progress)
+        {
+            total += it.get_finished();
         }
 
-        // run threads. keep notifying until we either have no threads left or the task list is empty.
-        process_tasks = true;
-        should_run.notify_all();
+        return total;
+    }
+
+    /** start submitted tasks and wait for all tasks to be completed, without rethrowing the tasks' exceptions. */
+    void wait_for_tasks()
+    {
+        auto run_begin = detail::trace_now();
 
-        // wait for all tasks to be processed.
-        while(!tasks.empty())
+        if(pending_tasks > 0)
         {
-            std::this_thread::yield();
+            // run threads.
+            start_tasks();
 
-            // check if (more) threads should be running. (tasks.size() may return a slightly inaccurate value though).
-            auto currently_active_threads = active_threads.load();
-            if(currently_active_threads < tasks.size() && currently_active_threads < thread_count)
-            {
-                should_run.notify_all();
-            }
+            // wait for all tasks to be processed.
+            completion.wait([this]() -> bool
+                            { return pending_tasks == 0; });
         }
 
+        finish_run(run_begin);
+    }
+
+    /** stop processing after all tasks finished, and wait for the workers to go idle. */
+    void finish_run(std::uint64_t run_begin)
+    {
         // we are done processing the tasks.
-        process_tasks = false;
+        set_processing(false);
 
         // threads might still be active.
-        while(active_threads > 0)
-        {
-            std::this_thread::yield();
-        }
+        completion.wait([this]() -> bool
+                        { return active_threads == 0; });
 
         // explicitly clean up task queue. this may not have been done by the worker threads
         // during task execution.
-        tasks.clear();
-    }
+        clear_queues();
 
-    void wait_and_exit()
-    {
-        destroy_threads();
+        // no task of the run is alive anymore, so the arenas can be reused. this includes the arena of the calling thread,
+        // which holds the oversized arena_tasks it pushed, unless the thread is a worker of another pool.
+        for(auto& it: arenas)
+        {
+            it.reset();
+        }
+        if(detail::current_arena == nullptr)
+        {
+            detail::thread_arena().reset();
+        }
+
+        control_trace.record("run_tasks_and_wait", run_begin);
     }
 
-    /** reset the number of threads in the pool. waits for all submitted tasks to be completed, then destroys and creates new thread pool with the number of new threads. */
-    void reset(std::size_t in_thread_count)
+    /** throw the exceptions of the last run as task_errors, and lift the cancellation. */
+    void rethrow_errors()
     {
-        run_tasks_and_wait();
-        destroy_threads();
+        std::vector<std::exception_ptr> failed;
+        {
+            std::unique_lock lock{error_mutex};
+            failed.swap(errors);
+            cancelled = false;
+        }
 
-        thread_count = std::max<std::size_t>(in_thread_count, 1);
-        stop = false;
-        create_threads();
+        if(!failed.empty())
+        {
+            throw task_errors{std::move(failed)};
+        }
     }
 
-    void start_tasks()
+    /** account for finished tasks. the last task wakes up the waiting thread. threads which are not workers pass no trace. */
+    void finish_tasks(std::size_t count, detail::trace_buffer* trace)
     {
-        process_tasks = true;
-        should_run.notify_all();
+        if(pending_tasks.fetch_sub(count) == count)
+        {
+            if(trace)
+            {
+                trace->record_instant("notify");
+            }
+            completion.notify();
+        }
     }
 
-    /** push a function with no arguments or return value into the task queue. this does not start the task. */
-    template<typename F>
-    void push_task(const F& task)
+    /** check whether all task queues are (possibly) empty. */
+    bool queues_empty() const
     {
-        // submit task.
-        tasks.push(task);
-    }
+        for(auto& it: queues)
+        {
+            if(!it->empty())
+            {
+                return false;
+            }
+        }
 
-    /** push a function with arguments, but no return value, into the task queue. this does not start the task. */
-    template<typename F, typename... A>
-    void push_task(const F& task, const A&... args)
-    {
-        push_task([task, args...]
-                  { task(args...); });
+        return true;
     }
 
+    /**
+     * push a task into a queue. a bounded queue which is full would not drain before the pool starts, so in that case
+     * processing is started and the push waits for a free slot. this is safe, since bounded queues need to be multi-producer.
+     */
     template<typename F>
-    void push_immediate_task(const F& task)
+    void emplace_task(queue_type& queue, F&& task)
     {
-        // submit task.
-        tasks.push(task);
-
-        // run threads.
-        process_tasks = true;
-        should_run.notify_one();
+        if constexpr(traits::is_bounded)
+        {
+            emplace_or_start([&queue, &task]() -> bool
+                             { return queue.try_emplace(std::forward<F>(task)); });
+        }
+        else
+        {
+            queue.emplace(std::forward<F>(task));
+        }
     }
 
-    template<typename F, typename... A>
-    void push_immediate_task(const F& task, const A&... args)
+    /** push a task into the lane of the given priority. a full bounded lane is handled as in emplace_task. */
+    template<typename F>
+    void emplace_priority_task(queue_type& queue, std::size_t priority, F&& task)
     {
-        push_immediate_task([task, args...]
-                            { task(args...); });
+        if constexpr(traits::is_bounded)
+        {
+            emplace_or_start([&queue, priority, &task]() -> bool
+                             { return queue.try_emplace_with_priority(priority, std::forward<F>(task)); });
+        }
+        else
+        {
+            queue.emplace_with_priority(priority, std::forward<F>(task));
+        }
     }
 
-    /** return the number of threads. */
-    std::size_t get_thread_count() const
+    /**
+     * push into a bounded queue with try_emplace, which only moves from the task on success. the workers may have parked
+     * while the queue filled up, so they are woken once per push which finds the queue full. they do not park again
+     * before the queue is empty.
+     */
+    template<typename TryEmplace>
+    void emplace_or_start(TryEmplace&& try_emplace)
+    {
+        if(!try_emplace())
+        {
+            start_tasks();
+            while(!try_emplace())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /** return the queue the next task is pushed into. distributes the tasks round-robin if there are multiple queues. */
+    queue_type& get_push_queue()
+    {
+        if(queues.size() == 1)
+        {
+            return *queues[0];
+        }
+
+        return *queues[next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    }
+
+    /** pop a task off a queue. a consumer index is passed for the worker's own queue, and omitted for other queues. */
+    bool pop_task(queue_type& queue, task_type& task, const std::size_t* consumer_index)
+    {
+        if constexpr(traits::has_consumer_index)
+        {
+            if(consumer_index)
+            {
+                return queue.try_pop(task, *consumer_index);
+            }
+        }
+
+        return queue.try_pop(task);
+    }
+
+    /** return the number of tasks a worker should claim at once from a queue with the given number of consumers. */
+    std::size_t get_claim_size(const queue_type& queue, std::size_t consumers) const
+    {
+        auto n = chunk_size.load();
+        if(n)
+        {
+            return n;
+        }
+
+        // claim a fraction of the remaining tasks, so that the other workers still find work.
+        return std::clamp<std::size_t>(queue.size() / (4 * std::max<std::size_t>(consumers, 1)), 1, max_adaptive_chunk_size);
+    }
+
+    /** pop up to max_n tasks off a queue. a consumer index is passed for the worker's own queue. returns the number of popped tasks. */
+    std::size_t pop_tasks(queue_type& queue, std::size_t consumers, std::vector<task_type>& batch, const std::size_t* consumer_index)
+    {
+        if constexpr(traits::supports_bulk_pop)
+        {
+            if constexpr(traits::has_consumer_index)
+            {
+                if(consumer_index)
+                {
+                    return queue.try_pop_bulk(std::back_inserter(batch), get_claim_size(queue, consumers), *consumer_index);
+                }
+            }
+
+            return queue.try_pop_bulk(std::back_inserter(batch), get_claim_size(queue, consumers));
+        }
+        else
+        {
+            task_type task;
+            if(pop_task(queue, task, consumer_index))
+            {
+                batch.emplace_back(std::move(task));
+                return 1;
+            }
+
+            return 0;
+        }
+    }
+
+    /**
+     * pop tasks on behalf of the worker with the given index. the worker's own queue is tried first, then the queues of the other nodes.
+     * source is set to the queue the tasks were popped from.
+     */
+    std::size_t pop_tasks(std::vector<task_type>& batch, std::size_t worker_index, std::size_t& source)
+    {
+        const auto& worker = placement.workers[worker_index];
+        if(auto count = pop_tasks(*queues[worker.queue], placement.queue_consumers[worker.queue], batch, &worker.queue_consumer); count > 0)
+        {
+            source = worker.queue;
+            return count;
+        }
+
+        for(std::size_t i = 1; i < queues.size(); ++i)
+        {
+            auto q = (worker.queue + i) % queues.size();
+            if(auto count = pop_tasks(*queues[q], thread_count, batch, nullptr); count > 0)
+            {
+                source = q;
+                return count;
+            }
+        }
+
+        return 0;
+    }
+
+    /** worker function. */
+    void worker(std::size_t worker_index)
+    {
+        // pin the thread before allocating anything, so that the worker's memory is local to its node.
+        pin_this_thread(placement.workers[worker_index].cpus);
+
+        // tasks claimed from the queue. keeps its capacity between runs.
+        std::vector<task_type> batch;
+
+        auto& stats = counters[worker_index];
+        auto& trace = worker_traces[worker_index];
+        auto& worker_progress = progress[worker_index];
+
+        // the histogram the latencies of the current task(s) are recorded into.
+        detail::latency_recorder_scope latency_scope;
+
+        // spawned tasks go into this worker's spawn queue.
+        detail::current_pool = this;
+        detail::current_worker_index = worker_index;
+        detail::current_arena = &arenas[worker_index];
+
+        // a task popped from a spawn queue.
+        task_type spawned;
+
+        set_idle();
+
+        while(true)
+        {
+            {
+                detail::stats_timer wait_timer;
+                auto wait_begin = detail::trace_now();
+                bool run = wait_for_work(worker_index);
+                stats.add_wait(wait_timer.elapsed_ns());
+                trace.record("wait", wait_begin);
+
+                // exit if the pool is stopped, or if the worker was retired by resize.
+                if(!run)
+                {
+                    break;
+                }
+            }
+
+            // process the tasks assigned to this thread. only check for an empty queue if popping failed,
+            // since empty() may be as expensive as try_pop.
+            while(process_tasks)
+            {
+                std::size_t source = 0;
+                if(auto count = pop_tasks(batch, worker_index, source); count > 0)
+                {
+                    latency_scope.select(&queue_latencies[source]);
+
+                    // execute tasks.
+                    detail::stats_timer busy_timer;
+                    for(auto& task: batch)
+                    {
+                        auto task_begin = detail::trace_now();
+                        invoke_queued_task(task);
+                        detail::record_task(&trace, task_begin);
+                    }
+                    batch.clear();
+
+                    stats.add_busy(busy_timer.elapsed_ns());
+                    stats.add_executed(count);
+                    worker_progress.add_finished(count);
+                    finish_tasks(count, &trace);
+                }
+                else if(pop_spawned_task(spawned, worker_index))
+                {
+                    latency_scope.select(&spawn_latency);
+
+                    detail::stats_timer busy_timer;
+                    auto task_begin = detail::trace_now();
+                    invoke_task(spawned);
+                    detail::record_task(&trace, task_begin);
+                    spawned = task_type{};
+
+                    stats.add_busy(busy_timer.elapsed_ns());
+                    stats.add_executed(1);
+                    worker_progress.add_finished(1);
+                    finish_tasks(1, &trace);
+                }
+                else
+                {
+                    stats.add_failed_pop();
+                    if(queues_empty() && spawn_queues_empty())
+                    {
+                        break;
+                    }
+                }
+            }
+
+            set_idle();
+        }
+    }
+
+    /** set process_tasks. the store is sequentially consistent: a worker about to park either sees it, or is seen (and woken) by the following wake_workers. */
+    void set_processing(bool processing)
+    {
+        process_tasks.store(processing);
+    }
+
+    /**
+     * wake up to count parked workers. spinning workers notice the new epoch by themselves. has to be called after the
+     * work is published, e.g. after pushing tasks.
+     */
+    void wake_workers(std::size_t count)
+    {
+        wake_epoch.fetch_add(1);
+
+        for(std::size_t i = 0; i < thread_count && count > 0; ++i)
+        {
+            if(parkers[i].unpark())
+            {
+                --count;
+            }
+        }
+    }
+
+    /** check whether the worker with the given index has to exit. */
+    bool should_exit(std::size_t worker_index) const
+    {
+        return stop || worker_index >= running_workers.load();
+    }
+
+    /**
+     * mark the calling worker active if there are tasks to process. the queues are only inspected while the worker is
+     * counted as active, so that finish_run cannot clear them concurrently: the worker either sees process_tasks cleared,
+     * or finish_run waits for it (both accesses are sequentially consistent).
+     */
+    bool try_activate()
+    {
+        if(!process_tasks)
+        {
+            return false;
+        }
+
+        ++active_threads;
+        if(process_tasks && (!queues_empty() || !spawn_queues_empty()))
+        {
+            return true;
+        }
+
+        set_idle();
+        return false;
+    }
+
+    /**
+     * let an idle worker wait until there are tasks to process (returns true, with the worker marked active) or until it
+     * has to exit (returns false). the worker spins first, then parks, see idle_policy.
+     */
+    bool wait_for_work(std::size_t worker_index)
+    {
+        auto& parker = parkers[worker_index];
+
+        const auto spin_count = idle_spin_count.load(std::memory_order_relaxed);
+        const auto spin_ns = idle_spin_ns.load(std::memory_order_relaxed);
+
+        while(true)
+        {
+            if(should_exit(worker_index))
+            {
+                return false;
+            }
+            if(try_activate())
+            {
+                return true;
+            }
+
+            // spin until the epoch changes. the clock is only read every few rounds.
+            const auto epoch = wake_epoch.load();
+            const auto spin_end = spin_ns > 0 ? std::chrono::steady_clock::now() + std::chrono::nanoseconds{spin_ns} : std::chrono::steady_clock::time_point{};
+
+            bool woken = false;
+            for(std::size_t i = 0; i < spin_count && !woken; ++i)
+            {
+                cpu_pause();
+                woken = wake_epoch.load(std::memory_order_relaxed) != epoch;
+
+                if(spin_ns > 0 && (i & 63) == 63 && std::chrono::steady_clock::now() >= spin_end)
+                {
+                    break;
+                }
+            }
+            if(woken)
+            {
+                continue;
+            }
+
+            // park. the state is re-checked after announcing it, so that a concurrent wake-up is not missed.
+            parker.prepare_park();
+            if(should_exit(worker_index))
+            {
+                parker.cancel_park();
+                return false;
+            }
+            if(try_activate())
+            {
+                parker.cancel_park();
+                return true;
+            }
+            parker.park();
+        }
+    }
+
+public:
+    /** default constructor does not create threads. */
+    deferred_thread_pool()
+    : thread_count{0}
+    , make_queue{make_queue_factory()}
+    {
+        queues.emplace_back(make_queue());
+    }
+
+    /** constructor. additional arguments are passed to the queue's constructor, e.g., the capacity of a bounded queue. */
+    template<typename... Args>
+    deferred_thread_pool(std::size_t in_thread_count, Args&&... queue_args)
+    : deferred_thread_pool{pool_config{in_thread_count}, std::forward<Args>(queue_args)...}
+    {
+    }
+
+    /**
+     * create the threads according to a configuration. additional arguments are passed to the queue's constructor.
+     * if the configuration asks for one queue per node, the additional queues are constructed from copies of the arguments.
+     */
+    template<typename... Args>
+    deferred_thread_pool(const pool_config& in_config, Args&&... queue_args)
+    : config{in_config}
+    , make_queue{make_queue_factory(queue_args...)}
+    {
+        queues.emplace_back(std::make_unique<queue_type>(std::forward<Args>(queue_args)...));
+        create_threads();
+    }
+
+    /** destructor. */
+    ~deferred_thread_pool()
+    {
+        destroy_threads();
+    }
+
+    /** disable copying. */
+    deferred_thread_pool(const deferred_thread_pool&) = delete;
+    deferred_thread_pool& operator=(const deferred_thread_pool&) = delete;
+
+    /**
+     * start submitted tasks and wait for all tasks to be completed. if tasks threw, a task_errors holding all their
+     * exceptions is thrown once all tasks finished (or were skipped, see set_cancel_on_error). the pool stays usable.
+     */
+    void run_tasks_and_wait()
+    {
+        wait_for_tasks();
+        rethrow_errors();
+    }
+
+    /**
+     * start submitted tasks and wait until all tasks are completed or the deadline passed. at the deadline, all tasks that
+     * did not start yet are dropped (see cancel_pending), and tasks spawned by the running tasks are skipped. running
+     * tasks cannot be interrupted, so the call returns once they finished; long tasks should poll a cancellation_token.
+     * exceptions are rethrown as in run_tasks_and_wait.
+     */
+    template<typename Clock, typename Duration>
+    run_result run_tasks_and_wait_until(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        auto run_begin = detail::trace_now();
+        const auto finished_before = get_finished_tasks();
+        const auto skipped_before = skipped_tasks.load();
+        const auto dropped_before = dropped_tasks.load();
+
+        run_result result;
+        if(pending_tasks > 0)
+        {
+            start_tasks();
+
+            if(!completion.wait_until(deadline, [this]() -> bool
+                                      { return pending_tasks == 0; }))
+            {
+                // skip everything that did not start yet, including tasks spawned from now on.
+                result.timed_out = true;
+                cancelled = true;
+                cancel_pending();
+
+                completion.wait([this]() -> bool
+                                { return pending_tasks == 0; });
+            }
+        }
+
+        finish_run(run_begin);
+
+        // skipped tasks were popped and are counted as finished, dropped tasks are not.
+        const auto skipped = skipped_tasks.load() - skipped_before;
+        result.completed = get_finished_tasks() - finished_before - skipped;
+        result.cancelled = skipped + dropped_tasks.load() - dropped_before;
+
+        rethrow_errors();
+        return result;
+    }
+
+    /** start submitted tasks and wait until all tasks are completed or the timeout expired. see run_tasks_and_wait_until. */
+    template<typename Rep, typename Period>
+    run_result run_tasks_and_wait_for(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        return run_tasks_and_wait_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    /**
+     * drop all tasks in the task queues which did not start yet, and return their number. can be called from any thread,
+     * including the pool's tasks, while the workers are running. every task is either run or dropped, never both.
+     * queues providing discard() drop all tasks with a single operation (e.g. spmc_queue), the others are emptied by popping.
+     *
+     * dropped tasks are not called. their futures report a broken promise once the tasks are destroyed, which may be at the
+     * end of the run. spawned child tasks are not dropped, since their parents wait for them.
+     */
+    std::size_t cancel_pending()
+    {
+        std::size_t dropped = 0;
+        for(auto& it: queues)
+        {
+            if constexpr(traits::supports_discard)
+            {
+                dropped += it->discard();
+            }
+            else
+            {
+                task_type task;
+                while(it->try_pop(task))
+                {
+                    task = task_type{};
+                    ++dropped;
+                }
+            }
+        }
+
+        if(dropped > 0)
+        {
+            dropped_tasks.fetch_add(dropped, std::memory_order_relaxed);
+            if(pending_tasks.fetch_sub(dropped) == dropped)
+            {
+                completion.notify();
+            }
+        }
+
+        return dropped;
+    }
+
+    /**
+     * set whether the first exception of a run cancels the remaining tasks of the run. cancelled tasks are popped, but
+     * not called, so a failed run stops consuming cpu time right away. futures of cancelled tasks report a broken promise.
+     */
+    void set_cancel_on_error(bool cancel)
+    {
+        cancel_on_error = cancel;
+    }
+
+    /** return whether the first exception of a run cancels the remaining tasks. */
+    bool get_cancel_on_error() const
+    {
+        return cancel_on_error;
+    }
+
+    void wait_and_exit()
+    {
+        destroy_threads();
+    }
+
+    /** reset the number of threads in the pool. waits for all submitted tasks to be completed, then destroys and creates new thread pool with the number of new threads. the placement settings are kept. */
+    void reset(std::size_t in_thread_count)
+    {
+        auto new_config = config;
+        new_config.thread_count = std::max<std::size_t>(in_thread_count, 1);
+        reset(new_config);
+    }
+
+    /** reset the pool's configuration. waits for all submitted tasks to be completed, then destroys and creates new threads according to the configuration. */
+    void reset(const pool_config& in_config)
+    {
+        run_tasks_and_wait();
+        destroy_threads();
+
+        config = in_config;
+        stop = false;
+        create_threads();
+    }
+
+    /**
+     * change the number of threads without tearing down the pool. waits for all submitted tasks to be completed, like reset,
+     * but the running workers (and their thread-local state) are kept: surplus workers are retired at this idle point, and
+     * missing workers are added next to the existing ones. falls back to reset if the existing workers would be placed
+     * differently, e.g. if queue_per_node changes the number of queues.
+     */
+    void resize(std::size_t in_thread_count)
+    {
+        auto new_config = config;
+        new_config.thread_count = std::max<std::size_t>(in_thread_count, 1);
+
+        auto new_placement = detail::make_placement(new_config);
+        if(threads.empty() || !detail::is_placement_prefix(placement, new_placement))
+        {
+            reset(new_config);
+            return;
+        }
+
+        run_tasks_and_wait();
+
+        const auto old_count = thread_count;
+        const auto new_count = new_placement.workers.size();
+        config = new_config;
+
+        if(new_count < old_count)
+        {
+            // the workers are idle, so the surplus workers exit as soon as they see the new worker count.
+            running_workers = new_count;
+            wake_epoch.fetch_add(1);
+            for(std::size_t i = new_count; i < old_count; ++i)
+            {
+                parkers[i].unpark();
+            }
+
+            for(std::size_t i = new_count; i < old_count; ++i)
+            {
+                threads[i].join();
+            }
+            thread_count = new_count;
+            threads.resize(new_count);
+        }
+
+        placement = std::move(new_placement);
+        resize_worker_data(new_count);
+
+        for(std::size_t q = 0; q < queues.size(); ++q)
+        {
+            if constexpr(traits::has_consumer_index)
+            {
+                queues[q]->set_consumer_count(placement.queue_consumers[q]);
+            }
+        }
+
+        if(new_count > old_count)
+        {
+            thread_count = new_count;
+            start_workers(old_count, new_count);
+        }
+    }
+
+    /** start processing the submitted tasks. wakes one worker per submitted task, up to the number of threads. */
+    void start_tasks()
+    {
+        control_trace.record_instant("start_tasks");
+        set_processing(true);
+        wake_workers(pending_tasks.load());
+    }
+
+    /** push a function with no arguments or return value into the task queue. this does not start the task. */
+    template<typename F>
+    void push_task(F&& task)
+    {
+        // submit task. the task has to be counted before it can be popped.
+        ++pending_tasks;
+        emplace_task(get_push_queue(), detail::make_task<task_type>(std::forward<F>(task)));
+    }
+
+    /** push a function with arguments, but no return value, into the task queue. the arguments are forwarded into the task. this does not start the task. */
+    template<typename F, typename... A, typename = std::enable_if_t<!detail::is_cancellation_token<F>>>
+    void push_task(F&& task, A&&... args)
+    {
+        push_task(detail::bind_task(std::forward<F>(task), std::forward<A>(args)...));
+    }
+
+    /** push a function with no arguments or return value, which is skipped if the token is cancelled before the task starts. this does not start the task. */
+    template<typename F>
+    void push_task(cancellation_token token, F&& task)
+    {
+        push_task(detail::make_cancellable_task(std::move(token), std::forward<F>(task), &skipped_tasks));
+    }
+
+    /** push a function with no arguments or return value into the task queue and start processing. the queue needs to be multi-producer (see queue_traits). */
+    template<typename F>
+    void push_immediate_task(F&& task)
+    {
+        static_assert(traits::is_multi_producer, "push_immediate_task: the workers may be running, so the queue needs to allow pushes while consumers pop (see queue_traits::is_multi_producer), e.g. mpmc_blocking_queue.");
+
+        // submit task.
+        ++pending_tasks;
+        emplace_task(get_push_queue(), detail::make_task<task_type>(std::forward<F>(task)));
+
+        // run threads.
+        set_processing(true);
+        wake_workers(1);
+    }
+
+    template<typename F, typename... A>
+    void push_immediate_task(F&& task, A&&... args)
+    {
+        push_immediate_task(detail::bind_task(std::forward<F>(task), std::forward<A>(args)...));
+    }
+
+    /** push a function with no arguments or return value, which is shown with the given name in traces. the name has to outlive the trace, e.g. a string literal. this does not start the task. */
+    template<typename F>
+    void push_named_task(const char* name, F&& task)
+    {
+        push_task(detail::make_named_task(name, std::forward<F>(task)));
+    }
+
+    /**
+     * push a function with no arguments or return value into the lane of the given priority, where 0 is the highest priority.
+     * requires a queue with priorities, e.g. priority_lane_queue. this does not start the task.
+     */
+    template<typename F>
+    void push_priority_task(std::size_t priority, F&& task)
+    {
+        static_assert(traits::has_priorities, "push_priority_task: the queue does not support priorities. use priority_lane_queue.");
+
+        ++pending_tasks;
+        emplace_priority_task(get_push_queue(), priority, detail::make_task<task_type>(std::forward<F>(task)));
+    }
+
+    /**
+     * push a function with no arguments or return value into the lane of the given priority and start processing.
+     * the lanes need to support pushes while the workers are running, e.g. priority_lane_queue<mpmc_blocking_queue<T>>.
+     */
+    template<typename F>
+    void push_immediate_priority_task(std::size_t priority, F&& task)
+    {
+        static_assert(traits::is_multi_producer, "push_immediate_priority_task: the workers may be running, so the lanes need to allow pushes while consumers pop, e.g. priority_lane_queue<mpmc_blocking_queue<T>>.");
+
+        push_priority_task(priority, std::forward<F>(task));
+
+        // run threads.
+        set_processing(true);
+        wake_workers(1);
+    }
+
+    /**
+     * push a function with no arguments or return value into the queue of a node. the node is an index into the nodes the workers
+     * were spread over, see get_node_count(). without queue_per_node, this is the same as push_task. this does not start the task.
+     */
+    template<typename F>
+    void push_task_to_node(std::size_t node, F&& task)
+    {
+        ++pending_tasks;
+        emplace_task(*queues[node % queues.size()], detail::make_task<task_type>(std::forward<F>(task)));
+    }
+
+    /** push a range of functions with no arguments or return value into the task queue. with multiple queues, the range is split into one contiguous block per queue. this does not start the tasks. */
+    template<typename R>
+    void push_tasks(R&& range)
+    {
+        auto first = std::begin(range);
+        auto last = std::end(range);
+
+        // submit tasks. the tasks have to be counted before they can be popped.
+        const std::size_t count = std::distance(first, last);
+        pending_tasks += count;
+
+        for(std::size_t q = 0; q < queues.size(); ++q)
+        {
+            auto block_last = std::next(first, count * (q + 1) / queues.size() - count * q / queues.size());
+            // with statistics, every task is wrapped individually. bounded queues take the tasks one by one, so that a full queue can be drained.
+            if constexpr(traits::supports_bulk_push && !traits::is_bounded && !stats_enabled)
+            {
+                queues[q]->push_bulk(first, block_last);
+                first = block_last;
+            }
+            else
+            {
+                for(; first != block_last; ++first)
+                {
+                    emplace_task(*queues[q], detail::make_task<task_type>(*first));
+                }
+            }
+        }
+    }
+
+    /**
+     * spawn a child task into a group. called from a worker, the task goes into the worker's own spawn queue, from where
+     * idle workers steal it; calls from other threads distribute the tasks over the spawn queues. spawned tasks do not
+     * go through the pool's task queue, so this is safe for every queue type and while the workers are running.
+     * if the pool is not processing tasks, the task is run by the next run_tasks_and_wait or by wait_for.
+     */
+    template<typename F>
+    void spawn(task_group& group, F&& task)
+    {
+        if(thread_count == 0)
+        {
+            task();
+            return;
+        }
+
+        auto worker_index = get_calling_worker();
+        auto& queue = spawn_queues[worker_index < thread_count ? worker_index : next_spawn_queue.fetch_add(1, std::memory_order_relaxed) % thread_count];
+
+        // count the task before it can be popped.
+        group.pending.fetch_add(1, std::memory_order_relaxed);
+        ++pending_tasks;
+        queue.emplace(detail::make_task<task_type>([this, g = &group, f = std::forward<F>(task)]() mutable
+                                                   {
+                                                       // the group is also finished if the task throws or was cancelled.
+                                                       struct finish
+                                                       {
+                                                           task_group* g;
+                                                           ~finish()
+                                                           {
+                                                               g->pending.fetch_sub(1, std::memory_order_release);
+                                                           }
+                                                       } guard{g};
+
+                                                       if(!cancelled.load(std::memory_order_relaxed))
+                                                       {
+                                                           f();
+                                                       }
+                                                       else
+                                                       {
+                                                           skipped_tasks.fetch_add(1, std::memory_order_relaxed);
+                                                       }
+                                                   }));
+
+        // wake up an idle worker to steal the task.
+        if(process_tasks && active_threads.load(std::memory_order_relaxed) < thread_count)
+        {
+            wake_workers(1);
+        }
+    }
+
+    /**
+     * wait until all tasks of a group finished. instead of blocking, the calling thread runs pending tasks: spawned tasks
+     * (its own first), and, if it is a worker of this pool, tasks from the task queue. this makes nested parallel regions
+     * (e.g. recursive divide and conquer) possible without deadlocks or additional threads.
+     */
+    void wait_for(task_group& group)
+    {
+        const auto worker_index = get_calling_worker();
+        const auto is_worker = worker_index < thread_count;
+        const auto first_queue = is_worker ? worker_index : 0;
+
+        // only workers own a trace buffer.
+        auto* trace = is_worker ? &worker_traces[worker_index] : nullptr;
+
+        // the waiting task continues with the histogram of its own queue.
+        detail::latency_recorder_scope latency_scope;
+
+        std::size_t idle_rounds = 0;
+        task_type task;
+        while(!group.done())
+        {
+            bool spawned = thread_count > 0 && pop_spawned_task(task, first_queue);
+            bool queued = false;
+            if(!spawned && is_worker)
+            {
+                const auto& worker = placement.workers[worker_index];
+                queued = pop_task(*queues[worker.queue], task, &worker.queue_consumer);
+            }
+
+            if(spawned || queued)
+            {
+                auto task_begin = detail::trace_now();
+                if(spawned)
+                {
+                    latency_scope.select(&spawn_latency);
+                    invoke_task(task);
+                }
+                else
+                {
+                    latency_scope.select(&queue_latencies[placement.workers[worker_index].queue]);
+                    invoke_queued_task(task);
+                }
+                detail::record_task(trace, task_begin);
+                task = task_type{};
+                if(is_worker)
+                {
+                    progress[worker_index].add_finished(1);
+                }
+                else
+                {
+                    helped_tasks.fetch_add(1, std::memory_order_relaxed);
+                }
+                finish_tasks(1, trace);
+                idle_rounds = 0;
+            }
+            else if(++idle_rounds < 64)
+            {
+                cpu_pause();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /** run a recorded batch of tasks and wait for all tasks to be completed. the batch's tasks are not pushed into the task queue, see task_batch. */
+    template<typename T>
+    void run(task_batch<T>& batch)
+    {
+        batch.run(*this, [this](T& task) noexcept
+                  { invoke_recorded_task(task); });
+    }
+
+    /**
+     * push a function with arguments into the task queue and return a future for its result. this does not start the task.
+     * the future only waits for this task, so it can be used after start_tasks() without waiting for the whole queue.
+     */
+    template<typename F, typename... A>
+    auto submit(F&& task, A&&... args) -> future<std::invoke_result_t<std::decay_t<F>&, std::decay_t<A>&...>>
+    {
+        using result_type = std::invoke_result_t<std::decay_t<F>&, std::decay_t<A>&...>;
+        static_assert(!std::is_reference_v<result_type>, "submit: tasks returning references are not supported. return a pointer or a std::reference_wrapper instead.");
+
+        auto state = detail::future_state<result_type>::create(future_states);
+        push_task([p = detail::promise<result_type>{state}, f = detail::bind_task(std::forward<F>(task), std::forward<A>(args)...)]() mutable
+                  { p.run(f); });
+
+        return future<result_type>{state};
+    }
+
+#if defined(CONCURRENCY_UTILS_HAS_COROUTINES)
+    /**
+     * push a coroutine handle into the task queue and start processing. the handle itself is stored as the task, so
+     * resuming does not allocate. the workers may be running, so the queue needs to be multi-producer (see queue_traits),
+     * e.g. mpmc_blocking_queue.
+     */
+    void push_coroutine(std::coroutine_handle<> handle)
+    {
+        push_immediate_task(handle);
+    }
+
+    /** return an awaitable which resumes the awaiting coroutine on one of the pool's workers, i.e., co_await pool.schedule(). */
+    detail::schedule_awaiter<deferred_thread_pool> schedule()
+    {
+        return detail::schedule_awaiter<deferred_thread_pool>{*this};
+    }
+#endif
+
+    /** set the number of tasks a worker claims from the queue at once. 0 (the default) adapts the number to the queue length. */
+    void set_chunk_size(std::size_t n)
+    {
+        chunk_size = n;
+    }
+
+    /** return the number of tasks a worker claims from the queue at once. 0 means the number is selected adaptively. */
+    std::size_t get_chunk_size() const
+    {
+        return chunk_size;
+    }
+
+    /** set how idle workers wait for tasks. takes effect the next time a worker goes idle. */
+    void set_idle_policy(const idle_policy& policy)
+    {
+        idle_spin_count = policy.spin_count;
+        idle_spin_ns = policy.spin_time.count();
+    }
+
+    /** return how idle workers wait for tasks. */
+    idle_policy get_idle_policy() const
+    {
+        return {idle_spin_count, std::chrono::nanoseconds{idle_spin_ns}};
+    }
+
+    /** return the number of threads. */
+    std::size_t get_thread_count() const
     {
         return thread_count;
     }
 
+    /** return the configuration the threads were created with. */
+    const pool_config& get_config() const
+    {
+        return config;
+    }
+
+    /** return the number of nodes the workers are distributed over. 1 if the workers were not spread over NUMA nodes. */
+    std::size_t get_node_count() const
+    {
+        return placement.nodes.size();
+    }
+
+    /** return the number of task queues. */
+    std::size_t get_queue_count() const
+    {
+        return queues.size();
+    }
+
     /** get waiting tasks. only returns a reliable answer if no threads are currently executing. */
     std::size_t get_waiting_tasks() const
     {
-        return tasks.size();
+        std::size_t total{0};
+        for(auto& it: queues)
+        {
+            total += it->size();
+        }
+
+        return total;
+    }
+
+    /**
+     * return a snapshot of the statistics. the counters are read without stopping the workers, so the values of
+     * different counters may be slightly out of sync. returns empty statistics if CONCURRENCY_UTILS_STATS is not defined.
+     */
+    pool_stats get_stats() const
+    {
+        pool_stats result;
+        if(stats_enabled && queue_latencies)
+        {
+            for(std::size_t i = 0; i < thread_count; ++i)
+            {
+                result.workers.push_back(counters[i].snapshot());
+            }
+            for(std::size_t q = 0; q < queues.size(); ++q)
+            {
+                result.queues.push_back(queue_latencies[q].snapshot());
+            }
+            result.spawned = spawn_latency.snapshot();
+        }
+
+        return result;
+    }
+
+    /** reset the statistics. waits for the submitted tasks to complete, so that no worker is active. */
+    void reset_stats()
+    {
+        wait_for_tasks();
+        if(!queue_latencies)
+        {
+            return;
+        }
+
+        for(auto& it: counters)
+        {
+            it.reset();
+        }
+        for(std::size_t q = 0; q < queues.size(); ++q)
+        {
+            queue_latencies[q].reset();
+        }
+        spawn_latency.reset();
+    }
+
+    /** return the recorded events of the controlling thread and of all workers. only consistent while the pool is idle. empty if CONCURRENCY_UTILS_TRACE is not defined. */
+    std::vector<thread_trace> get_trace() const
+    {
+        std::vector<thread_trace> result;
+        if(trace_enabled && !worker_traces.empty())
+        {
+            result.push_back({"control", control_trace.snapshot()});
+            for(std::size_t i = 0; i < thread_count; ++i)
+            {
+                result.push_back({"worker " + std::to_string(i), worker_traces[i].snapshot()});
+            }
+        }
+
+        return result;
+    }
+
+    /** write the recorded events as Chrome trace JSON, which can be opened in chrome://tracing or the Perfetto UI. only consistent while the pool is idle. */
+    void write_trace(std::ostream& out) const
+    {
+        write_chrome_trace(out, get_trace());
+    }
+
+    /** discard the recorded events. waits for the submitted tasks to complete, so that no worker is writing. */
+    void clear_trace()
+    {
+        wait_for_tasks();
+        control_trace.clear();
+        for(auto& it: worker_traces)
+        {
+            it.clear();
+        }
     }
 
     /** return whether the pool is currently processing tasks. */
@@ -0,0 +1,278 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * opt-in execution tracing for the thread pool. define CONCURRENCY_UTILS_TRACE before including the library to enable it.
+ * without the define, the recording functions are empty and no buffers are allocated.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+#ifndef CONCURRENCY_UTILS_TRACE_CAPACITY
+/** number of events kept per thread. older events are overwritten. has to be a power of two. */
+#    define CONCURRENCY_UTILS_TRACE_CAPACITY 16384
+#endif
+
+namespace concurrency_utils
+{
+
+/** whether events are traced. */
+#if defined(CONCURRENCY_UTILS_TRACE)
+constexpr bool trace_enabled = true;
+#else
+constexpr bool trace_enabled = false;
+#endif
+
+/** a traced event. */
+struct trace_event
+{
+    /** the event's name. has to outlive the trace, e.g. a string literal. */
+    const char* name{nullptr};
+
+    /** start time in nanoseconds. */
+    std::uint64_t begin_ns{0};
+
+    /** duration in nanoseconds. 0 for instant events. */
+    std::uint64_t duration_ns{0};
+
+    /** whether this is an instant event, e.g. a notification. */
+    bool instant{false};
+};
+
+/** the events of one thread. */
+struct thread_trace
+{
+    /** the thread's name. */
+    std::string name;
+
+    /** events in the order they were recorded. */
+    std::vector<trace_event> events;
+};
+
+namespace detail
+{
+
+/** append a string as JSON string literal. */
+inline void write_json_string(std::ostream& out, const char* s)
+{
+    out << '"';
+    for(; s && *s; ++s)
+    {
+        auto c = static_cast<unsigned char>(*s);
+        if(c == '"' || c == '\\')
+        {
+            out << '\\' << *s;
+        }
+        else if(c < 0x20)
+        {
+            static const char hex[] = "0123456789abcdef";
+            out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+        }
+        else
+        {
+            out << *s;
+        }
+    }
+    out << '"';
+}
+
+} /* namespace detail */
+
+/**
+ * write traces in the Chrome trace event format (JSON), which can be loaded by chrome://tracing and by the Perfetto UI.
+ * every thread trace is shown as one thread of a single process.
+ */
+inline void write_chrome_trace(std::ostream& out, const std::vector<thread_trace>& threads)
+{
+    // time stamps are in microseconds.
+    auto write_us = [&out](std::uint64_t ns)
+    {
+        out << ns / 1000 << '.' << static_cast<char>('0' + (ns / 100) % 10) << static_cast<char>('0' + (ns / 10) % 10) << static_cast<char>('0' + ns % 10);
+    };
+
+    out << "{\"traceEvents\":[";
+
+    bool first = true;
+    for(std::size_t tid = 0; tid < threads.size(); ++tid)
+    {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        detail::write_json_string(out, threads[tid].name.c_str());
+        out << "}}";
+        first = false;
+
+        for(auto& e: threads[tid].events)
+        {
+            out << ",\n{\"name\":";
+            detail::write_json_string(out, e.name ? e.name : "task");
+            out << ",\"ph\":\"" << (e.instant ? "i" : "X") << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":";
+            write_us(e.begin_ns);
+            if(e.instant)
+            {
+                out << ",\"s\":\"t\"";
+            }
+            else
+            {
+                out << ",\"dur\":";
+                write_us(e.duration_ns);
+            }
+            out << "}";
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+namespace detail
+{
+
+#if defined(CONCURRENCY_UTILS_TRACE)
+
+/** return the current time for tracing, in nanoseconds. */
+inline std::uint64_t trace_now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * ring buffer of events, written by a single thread. the writer never blocks and overwrites the oldest events.
+ * snapshots are only consistent while the writer is idle, e.g. after run_tasks_and_wait().
+ */
+class trace_buffer
+{
+    static constexpr std::size_t capacity = CONCURRENCY_UTILS_TRACE_CAPACITY;
+    static_assert((capacity & (capacity - 1)) == 0, "CONCURRENCY_UTILS_TRACE_CAPACITY has to be a power of two.");
+
+    /** the events. */
+    std::unique_ptr<trace_event[]> events{std::make_unique<trace_event[]>(capacity)};
+
+    /** number of recorded events. */
+    alignas(cache_line_size) std::atomic_size_t head{0};
+
+public:
+    /** record an event which started at begin_ns and ends now. */
+    void record(const char* name, std::uint64_t begin_ns)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        events[h & (capacity - 1)] = {name, begin_ns, trace_now() - begin_ns, false};
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    /** record an instant event. */
+    void record_instant(const char* name)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        events[h & (capacity - 1)] = {name, trace_now(), 0, true};
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    /** return the recorded events, oldest first. */
+    std::vector<trace_event> snapshot() const
+    {
+        auto h = head.load(std::memory_order_acquire);
+        auto n = std::min(h, capacity);
+
+        std::vector<trace_event> result;
+        result.reserve(n);
+        for(auto i = h - n; i < h; ++i)
+        {
+            result.push_back(events[i & (capacity - 1)]);
+        }
+
+        return result;
+    }
+
+    /** discard all events. */
+    void clear()
+    {
+        head = 0;
+    }
+};
+
+/** the name of the task currently executed by this thread. set by named tasks. */
+inline thread_local const char* current_task_name = nullptr;
+
+/** attach a name to a task. */
+template<typename F>
+auto make_named_task(const char* name, F&& f)
+{
+    return [name, f = std::forward<F>(f)]() mutable
+    {
+        current_task_name = name;
+        f();
+    };
+}
+
+/** record the execution of a task which started at begin_ns. uses the task's name, if it has one. threads without a buffer pass nullptr. */
+inline void record_task(trace_buffer* trace, std::uint64_t begin_ns)
+{
+    if(trace)
+    {
+        trace->record(current_task_name ? current_task_name : "task", begin_ns);
+    }
+    current_task_name = nullptr;
+}
+
+#else
+
+/** no time is taken if tracing is disabled. */
+constexpr std::uint64_t trace_now()
+{
+    return 0;
+}
+
+/** no-op trace buffer. */
+class trace_buffer
+{
+public:
+    void record(const char*, std::uint64_t)
+    {
+    }
+
+    void record_instant(const char*)
+    {
+    }
+
+    std::vector<trace_event> snapshot() const
+    {
+        return {};
+    }
+
+    void clear()
+    {
+    }
+};
+
+/** nothing to record. */
+inline void record_task(trace_buffer*, std::uint64_t)
+{
+}
+
+/** names are dropped if tracing is disabled. */
+template<typename F>
+decltype(auto) make_named_task(const char*, F&& f)
+{
+    return std::forward<F>(f);
+}
+
+#endif
+
+} /* namespace detail */
+
+} /* namespace concurrency_utils */
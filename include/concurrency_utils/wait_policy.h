@@ -0,0 +1,249 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * wait strategies for threads waiting on the completion of tasks.
+ *
+ * a wait policy provides
+ *  - wait(condition): block until condition() returns true,
+ *  - wait_until(deadline, condition): block until condition() returns true or the deadline passed. returns the condition's last value,
+ *  - notify(): wake up waiting threads. has to be called after every change which may make a waited-on condition true.
+ *
+ * idle_policy configures how the workers of a deferred_thread_pool wait for tasks: they spin for a while, and then park
+ * on a per-worker semaphore (detail::worker_parker), so that the pool can wake exactly the workers it needs.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021-Present.
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+// include dependencies.
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+#include "common.h"
+
+namespace concurrency_utils
+{
+
+/** busy-wait by yielding the time slice until the condition holds. lowest latency, but occupies the waiting core. */
+class spin_wait
+{
+public:
+    /** wait until the condition holds. */
+    template<typename C>
+    void wait(C condition)
+    {
+        while(!condition())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /** wait until the condition holds or the deadline passed. */
+    template<typename Clock, typename Duration, typename C>
+    bool wait_until(const std::chrono::time_point<Clock, Duration>& deadline, C condition)
+    {
+        while(!condition())
+        {
+            if(Clock::now() >= deadline)
+            {
+                return condition();
+            }
+
+            std::this_thread::yield();
+        }
+
+        return true;
+    }
+
+    /** nothing to do, since nobody is sleeping. */
+    void notify()
+    {
+    }
+};
+
+/**
+ * spin for a short while using the processor's pause instruction, then park the thread on a condition variable.
+ * notify only touches the mutex if a thread is actually parked.
+ *
+ * the caller publishes whatever makes the condition true before calling notify. a fence on either side orders that
+ * publication against the parked_threads handshake, so either the waiter sees the condition, or notify sees the waiter.
+ * this holds even if the publication itself is only a release store, e.g. a push into mpmc_bounded_queue.
+ */
+template<std::size_t spin_count = 1024>
+class backoff_wait
+{
+    /** mutex protecting the parked state. */
+    std::mutex wait_mutex;
+
+    /** condition variable for parked threads. */
+    std::condition_variable wake_up;
+
+    /** number of parked threads. */
+    std::atomic_size_t parked_threads{0};
+
+public:
+    /** wait until the condition holds. */
+    template<typename C>
+    void wait(C condition)
+    {
+        for(std::size_t i = 0; i < spin_count; ++i)
+        {
+            if(condition())
+            {
+                return;
+            }
+
+            cpu_pause();
+        }
+
+        std::unique_lock lock{wait_mutex};
+
+        // the increment needs to be visible before we check the condition, so that notify sees it. pairs with the fence in notify.
+        ++parked_threads;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake_up.wait(lock, condition);
+        --parked_threads;
+    }
+
+    /** wait until the condition holds or the deadline passed. */
+    template<typename Clock, typename Duration, typename C>
+    bool wait_until(const std::chrono::time_point<Clock, Duration>& deadline, C condition)
+    {
+        for(std::size_t i = 0; i < spin_count; ++i)
+        {
+            if(condition())
+            {
+                return true;
+            }
+
+            cpu_pause();
+        }
+
+        std::unique_lock lock{wait_mutex};
+
+        ++parked_threads;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto result = wake_up.wait_until(lock, deadline, condition);
+        --parked_threads;
+
+        return result;
+    }
+
+    /** wake up all parked threads. */
+    void notify()
+    {
+        // order the caller's publication before reading parked_threads. pairs with the fence in wait.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(parked_threads.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+
+        // acquire the mutex once, so that a thread which just checked the condition is parked before we notify.
+        {
+            std::unique_lock lock{wait_mutex};
+        }
+        wake_up.notify_all();
+    }
+};
+
+/**
+ * how idle workers wait for new tasks. a worker first spins, watching the pool's wake-up counter, and parks when the
+ * spin budget is used up. spinning bridges short gaps between runs without a system call, parking frees the core.
+ */
+struct idle_policy
+{
+    /** default number of spin rounds. spinning only pays off if it does not take the core of the thread pushing the tasks, so single-core machines park immediately. */
+    static std::size_t default_spin_count()
+    {
+        return std::thread::hardware_concurrency() > 1 ? 1024 : 0;
+    }
+
+    /** number of spin rounds before parking. 0 parks immediately. */
+    std::size_t spin_count{default_spin_count()};
+
+    /** upper bound for the spinning time, which ends the spinning before spin_count rounds. zero means no time limit. */
+    std::chrono::nanoseconds spin_time{0};
+};
+
+namespace detail
+{
+
+/**
+ * a binary semaphore for parking a single worker. waking a worker only touches that worker's mutex, and only if the
+ * worker is actually parked.
+ *
+ * the worker announces itself with prepare_park, checks (again) for work and then either parks or cancels. a waker
+ * publishes the work before calling unpark, so either the worker sees the work, or the waker sees the parked worker.
+ */
+class alignas(cache_line_size) worker_parker
+{
+    /** states of the worker. */
+    enum : int
+    {
+        running = 0,
+        parked = 1,
+        notified = 2
+    };
+
+    /** the worker's state. */
+    std::atomic_int state{running};
+
+    /** mutex for sleeping. */
+    std::mutex park_mutex;
+
+    /** condition variable for sleeping. */
+    std::condition_variable wake_up;
+
+public:
+    /** announce that the worker is about to park. the worker has to check for work afterwards. */
+    void prepare_park()
+    {
+        state.store(parked);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /** the worker found work after prepare_park. */
+    void cancel_park()
+    {
+        state.store(running, std::memory_order_relaxed);
+    }
+
+    /** sleep until unpark is called. returns immediately if unpark was called after prepare_park. */
+    void park()
+    {
+        {
+            std::unique_lock lock{park_mutex};
+            wake_up.wait(lock, [this]() -> bool
+                         { return state.load() != parked; });
+        }
+        state.store(running, std::memory_order_relaxed);
+    }
+
+    /** wake the worker if it is parked (or about to park). returns whether the worker was woken. */
+    bool unpark()
+    {
+        int expected = parked;
+        if(!state.compare_exchange_strong(expected, notified))
+        {
+            return false;
+        }
+
+        // acquire the mutex once, so that a worker which just checked its state is asleep before we notify.
+        {
+            std::unique_lock lock{park_mutex};
+        }
+        wake_up.notify_one();
+        return true;
+    }
+};
+
+} /* namespace detail */
+
+} /* namespace concurrency_utils */
@@ -9,18 +9,34 @@
  */
 
 #include <vector>
+#include <numeric>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <random>
+#include <array>
+
+#if defined(CONCURRENCY_UTILS_HAS_PARALLEL_STL)
+#    include <execution>
+#endif
 
 /* Google benchmark */
 #include <benchmark/benchmark.h>
 
 /* concurrency uttils */
 #include "concurrency_utils/thread_pool.h"
+#include "concurrency_utils/continuous_thread_pool.h"
+#include "concurrency_utils/parallel.h"
+#include "concurrency_utils/task_graph.h"
+#include "concurrency_utils/pipeline.h"
+#include "concurrency_utils/algorithms.h"
 
-/* math header. */
+/* math headers. */
 #include "../common/vec4.h"
+#include "../common/vec4_simd.h"
 
-/** global variable to perform random calculation in example task. don't expect this to hold any valid value (also due to possible concurrent reads/writes). */
-vec4 out{1, 0, 0, 0};
+/** per-thread variable to perform random calculation in example task. don't expect this to hold any valid value. thread-local, so that the workers do not race on it. */
+thread_local vec4 out{1, 0, 0, 0};
 
 /** some normalized vector used in the calculations. */
 const vec4 l{0.5f, 0.5f, 0.70710678f};
@@ -46,6 +62,123 @@ void example_task()
             out = v;
         }
     }
+
+    benchmark::DoNotOptimize(out);
+}
+
+/** the calculation of example_task on a single vector, for vec4 and vec4_simd. */
+template<typename V>
+V example_kernel(V v)
+{
+    const V light{l.x, l.y, l.z, l.w};
+    for(int i = 0; i < block_size * block_size; ++i)
+    {
+        float angle = dot(v.normalized(), light);
+        float dist_sq = (v - light).length_squared();
+
+        v = (v + light * dist_sq * angle);
+        v.normalize();
+    }
+    return v;
+}
+
+/** the calculation of example_task on a batch of vectors, float_pack::width vectors at a time. */
+template<std::size_t N>
+vec4_soa<N> example_kernel_soa(const vec4_soa<N>& in)
+{
+    const auto lx = float_pack::broadcast(l.x);
+    const auto ly = float_pack::broadcast(l.y);
+    const auto lz = float_pack::broadcast(l.z);
+    const auto lw = float_pack::broadcast(l.w);
+
+    vec4_soa<N> result;
+    for(std::size_t i = 0; i < N; i += float_pack::width)
+    {
+        auto x = float_pack::load(in.x + i);
+        auto y = float_pack::load(in.y + i);
+        auto z = float_pack::load(in.z + i);
+        auto w = float_pack::load(in.w + i);
+
+        for(int j = 0; j < block_size * block_size; ++j)
+        {
+            auto one_over_length = (x * x + y * y + z * z + w * w).one_over_sqrt();
+            auto angle = (x * lx + y * ly + z * lz + w * lw) * one_over_length;
+
+            auto dx = x - lx, dy = y - ly, dz = z - lz, dw = w - lw;
+            auto s = (dx * dx + dy * dy + dz * dz + dw * dw) * angle;
+
+            x = x + lx * s;
+            y = y + ly * s;
+            z = z + lz * s;
+            w = w + lw * s;
+
+            one_over_length = (x * x + y * y + z * z + w * w).one_over_sqrt();
+            x = x * one_over_length;
+            y = y * one_over_length;
+            z = z * one_over_length;
+            w = w * one_over_length;
+        }
+
+        x.store(result.x + i);
+        y.store(result.y + i);
+        z.store(result.z + i);
+        w.store(result.w + i);
+    }
+
+    return result;
+}
+
+/** number of threads used by the sweeps and the latency benchmarks. */
+static std::int64_t hardware_threads()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/** add the thread counts 1, 2, 4, ... up to and including the hardware concurrency. */
+static void thread_sweep(benchmark::internal::Benchmark* b)
+{
+    b->ArgName("threads");
+    for(std::int64_t threads = 1; threads < hardware_threads(); threads *= 2)
+    {
+        b->Arg(threads);
+    }
+    b->Arg(hardware_threads());
+}
+
+/** report the latency percentiles of the samples (in nanoseconds) as counters. */
+static void report_percentiles(benchmark::State& state, std::vector<std::uint64_t>& samples)
+{
+    if(samples.empty())
+    {
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) -> double
+    {
+        return static_cast<double>(samples[static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1))]);
+    };
+
+    state.counters["p50_ns"] = percentile(0.5);
+    state.counters["p90_ns"] = percentile(0.9);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+    state.counters["max_ns"] = static_cast<double>(samples.back());
+}
+
+/** return the current time in nanoseconds. */
+static std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** busy task running for about the given time. */
+static void spin_task(std::uint64_t ns)
+{
+    auto end = now_ns() + ns;
+    while(now_ns() < end)
+    {
+    }
 }
 
 template<typename T>
@@ -65,10 +198,1148 @@ static void bench_queue(benchmark::State& state)
         // run tasks.
         pool.run_tasks_and_wait();
     }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** push more tasks than a bounded queue holds, so that the pool starts while the tasks are pushed. the argument is the capacity. */
+template<typename T>
+static void bench_bounded_overflow(benchmark::State& state)
+{
+    const std::size_t capacity = state.range(0);
+    concurrency_utils::deferred_thread_pool<T> pool{4, capacity};
+
+    const std::size_t task_count = 4 * capacity;
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task(example_task);
+        }
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** push all tasks with a single push_tasks call. */
+template<typename T>
+static void bench_queue_bulk(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    std::size_t task_count = state.range(0);
+    std::vector<void (*)()> batch(task_count, example_task);
+    for(auto _: state)
+    {
+        // fill pool with tasks.
+        pool.push_tasks(batch);
+
+        // run tasks.
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** run the example tasks through parallel_for, which pushes a few chunks per worker instead of one task per call. */
+template<typename T>
+static void bench_parallel_for(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    std::size_t task_count = state.range(0);
+    for(auto _: state)
+    {
+        concurrency_utils::parallel_for(pool, std::size_t{0}, task_count, std::size_t{0}, [](std::size_t)
+                                        { example_task(); });
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** replay a recorded batch of example tasks. in contrast to bench_queue, the tasks are not pushed again on every iteration. */
+template<typename T>
+static void bench_batch_replay(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    std::size_t task_count = state.range(0);
+    concurrency_utils::task_batch<typename T::value_type> batch;
+    for(std::size_t i = 0; i < task_count; ++i)
+    {
+        batch.add(example_task);
+    }
+
+    for(auto _: state)
+    {
+        pool.run(batch);
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** run the example tasks with a given number of threads. */
+template<typename T>
+static void bench_thread_count(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(state.range(0))};
+
+    std::size_t task_count = state.range(1);
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task(example_task);
+        }
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** pool configurations for bench_placement: unpinned, pinned to all cpus, spread over the NUMA nodes with one queue per node. */
+static concurrency_utils::pool_config placement_config(std::int64_t mode)
+{
+    concurrency_utils::pool_config config;
+    config.thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    if(mode == 1)
+    {
+        for(std::size_t cpu = 0; cpu < config.thread_count; ++cpu)
+        {
+            config.cpus.push_back(cpu);
+        }
+    }
+    else if(mode == 2)
+    {
+        config.spread_numa_nodes = true;
+        config.queue_per_node = true;
+    }
+
+    return config;
+}
+
+/** memory-bound tasks. every task sums up its own buffer, which was first touched by a worker. */
+template<typename T>
+static void bench_placement(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{placement_config(state.range(0))};
+
+    constexpr std::size_t buffer_size = 1 << 16;
+    const std::size_t task_count = 4 * pool.get_thread_count();
+
+    std::vector<std::vector<float>> buffers(task_count);
+    std::vector<float> sums(task_count);
+    for(std::size_t i = 0; i < task_count; ++i)
+    {
+        pool.push_task([&buffers, i]()
+                       { buffers[i].assign(buffer_size, 1.0f); });
+    }
+    pool.run_tasks_and_wait();
+
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task([&buffers, &sums, i]()
+                           { sums[i] = std::accumulate(buffers[i].begin(), buffers[i].end(), 0.0f); });
+        }
+        pool.run_tasks_and_wait();
+        benchmark::DoNotOptimize(sums.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+    state.SetBytesProcessed(state.iterations() * task_count * buffer_size * sizeof(float));
+}
+
+/** number of stages and tasks per stage of the pipeline benchmarks. */
+constexpr std::size_t pipeline_stages = 4;
+constexpr std::size_t pipeline_width = 16;
+
+/** a pipeline task with uneven cost, so that waiting for whole stages leaves workers idle. */
+static void pipeline_task(std::size_t stage, std::size_t i)
+{
+    for(std::size_t k = 0; k < 1 + (stage * 7 + i * 3) % 8; ++k)
+    {
+        example_task();
+    }
+}
+
+/** run the pipeline stage after stage, waiting for the whole pool between the stages. */
+template<typename T>
+static void bench_stage_barriers(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    for(auto _: state)
+    {
+        for(std::size_t stage = 0; stage < pipeline_stages; ++stage)
+        {
+            for(std::size_t i = 0; i < pipeline_width; ++i)
+            {
+                pool.push_task([stage, i]()
+                               { pipeline_task(stage, i); });
+            }
+            pool.run_tasks_and_wait();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * pipeline_stages * pipeline_width);
+}
+
+/** run the pipeline as a task graph. a task only depends on two tasks of the previous stage. */
+template<typename T>
+static void bench_task_graph(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    concurrency_utils::task_graph graph;
+    for(std::size_t stage = 0; stage < pipeline_stages; ++stage)
+    {
+        for(std::size_t i = 0; i < pipeline_width; ++i)
+        {
+            auto id = graph.add_node([stage, i]()
+                                     { pipeline_task(stage, i); });
+            if(stage > 0)
+            {
+                auto previous = (stage - 1) * pipeline_width;
+                graph.add_edge(previous + i, id);
+                graph.add_edge(previous + (i + 1) % pipeline_width, id);
+            }
+        }
+    }
+
+    for(auto _: state)
+    {
+        graph.run(pool);
+    }
+
+    state.SetItemsProcessed(state.iterations() * pipeline_stages * pipeline_width);
+}
+
+/** push an urgent task behind a batch of bulk tasks. uses a priority lane if the queue supports it. */
+template<typename T>
+static void push_urgent_task(concurrency_utils::deferred_thread_pool<T>& pool, std::atomic_bool& flag)
+{
+    if constexpr(concurrency_utils::queue_traits<T>::has_priorities)
+    {
+        pool.push_priority_task(0, [&flag]()
+                                { flag = true; });
+    }
+    else
+    {
+        pool.push_task([&flag]()
+                       { flag = true; });
+    }
+}
+
+/** measure the time until an urgent task runs, which was pushed after the given number of bulk tasks. */
+template<typename T>
+static void bench_urgent_latency(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    std::size_t task_count = state.range(0);
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task(example_task);
+        }
+
+        std::atomic_bool urgent_done{false};
+        push_urgent_task(pool, urgent_done);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        pool.start_tasks();
+        while(!urgent_done)
+        {
+            std::this_thread::yield();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        pool.run_tasks_and_wait();
+        state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+    }
+}
+
+/** push tasks into a continuous pool and wait until it is idle. */
+template<typename T>
+static void bench_continuous(benchmark::State& state)
+{
+    concurrency_utils::continuous_thread_pool<T> pool{4};
+
+    std::size_t task_count = state.range(0);
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task(example_task);
+        }
+        pool.wait_idle();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** round trip of a single task through a continuous pool. */
+template<typename T>
+static void bench_continuous_latency(benchmark::State& state)
+{
+    concurrency_utils::continuous_thread_pool<T> pool{4};
+
+    for(auto _: state)
+    {
+        std::atomic_bool done{false};
+        pool.push_task([&done]()
+                       { done = true; });
+        while(!done)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    pool.wait_idle();
+}
+
+#if defined(CONCURRENCY_UTILS_HAS_COROUTINES)
+/** hop onto the pool a number of times. */
+template<typename Pool>
+static concurrency_utils::task<> hop(Pool& pool, std::size_t count)
+{
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        co_await pool.schedule();
+    }
+}
+
+/** resume a coroutine on the pool repeatedly. every hop is a single queue operation. */
+template<typename T>
+static void bench_coroutine_hops(benchmark::State& state)
+{
+    concurrency_utils::continuous_thread_pool<T> pool{4};
+
+    std::size_t hop_count = state.range(0);
+    for(auto _: state)
+    {
+        concurrency_utils::sync_wait(hop(pool, hop_count));
+    }
+
+    state.SetItemsProcessed(state.iterations() * hop_count);
 }
+#endif
+
+/** run the example tasks on 1, 2, 4, ... threads, up to the hardware concurrency. */
+template<typename T>
+static void bench_thread_sweep(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(state.range(0))};
+
+    constexpr std::size_t task_count = 10000;
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task(example_task);
+        }
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** run tasks of the given duration (in nanoseconds). the task count is chosen such that a round takes about 20ms of cpu time. */
+template<typename T>
+static void bench_task_granularity(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(hardware_threads())};
+
+    const std::uint64_t task_ns = state.range(0);
+    const std::size_t task_count = std::clamp<std::uint64_t>(20'000'000 / task_ns, 16, 100'000);
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task([task_ns]()
+                           { spin_task(task_ns); });
+        }
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+    state.counters["efficiency"] = benchmark::Counter(static_cast<double>(state.iterations() * task_count * task_ns) * 1e-9 / pool.get_thread_count(), benchmark::Counter::kIsRate);
+}
+
+/** pool overhead per task: push and run empty tasks. */
+template<typename T>
+static void bench_empty_tasks(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(state.range(0))};
+
+    constexpr std::size_t task_count = 10000;
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task([]() {});
+        }
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** uncontended queue overhead: push a batch of empty tasks and pop it on the same thread, without a pool. */
+template<typename T>
+static void bench_queue_ops(benchmark::State& state)
+{
+    T queue;
+    typename T::value_type task;
+
+    constexpr std::size_t batch_size = 1000;
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < batch_size; ++i)
+        {
+            queue.push([]() {});
+        }
+        while(queue.try_pop(task))
+        {
+        }
+        queue.clear();
+    }
+
+    state.SetItemsProcessed(state.iterations() * batch_size);
+}
+
+/** memory-bound tasks: every task sums up a slice of a buffer which is much larger than the caches. */
+template<typename T>
+static void bench_memory_bound(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(state.range(0))};
+
+    constexpr std::size_t buffer_size = std::size_t{1} << 24;
+    constexpr std::size_t task_count = 256;
+    constexpr std::size_t slice_size = buffer_size / task_count;
+
+    std::vector<float> buffer(buffer_size, 1.0f);
+    std::vector<float> sums(task_count);
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task([&buffer, &sums, i]()
+                           { sums[i] = std::accumulate(buffer.begin() + i * slice_size, buffer.begin() + (i + 1) * slice_size, 0.0f); });
+        }
+        pool.run_tasks_and_wait();
+        benchmark::DoNotOptimize(sums.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+    state.SetBytesProcessed(state.iterations() * buffer_size * sizeof(float));
+}
+
+/** time from push_immediate_task until the task starts, on a running pool. the manual time is the latency, the percentiles are reported as counters. */
+template<typename T>
+static void bench_push_latency(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(hardware_threads())};
+
+    std::vector<std::uint64_t> samples;
+    samples.reserve(state.max_iterations);
+
+    for(auto _: state)
+    {
+        std::atomic_uint64_t started{0};
+        auto pushed = now_ns();
+        pool.push_immediate_task([&started]()
+                                 { started = now_ns(); });
+        while(started == 0)
+        {
+            std::this_thread::yield();
+        }
+
+        auto latency = started - pushed;
+        samples.push_back(latency);
+        state.SetIterationTime(static_cast<double>(latency) * 1e-9);
+    }
+
+    pool.run_tasks_and_wait();
+    report_percentiles(state, samples);
+}
+
+/** pool shared by the producer threads of bench_multi_producer. */
+template<typename T>
+static std::unique_ptr<concurrency_utils::continuous_thread_pool<T>> shared_pool;
+
+/** several producer threads push into a continuous pool concurrently. every producer waits for its own tasks. */
+template<typename T>
+static void bench_multi_producer(benchmark::State& state)
+{
+    if(state.thread_index() == 0)
+    {
+        shared_pool<T> = std::make_unique<concurrency_utils::continuous_thread_pool<T>>(static_cast<std::size_t>(hardware_threads()));
+    }
+
+    constexpr std::size_t task_count = 1000;
+    for(auto _: state)
+    {
+        std::atomic_size_t done{0};
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            shared_pool<T>->push_task([&done]()
+                                      {
+                                          example_task();
+                                          done.fetch_add(1, std::memory_order_release); });
+        }
+        while(done.load(std::memory_order_acquire) != task_count)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if(state.thread_index() == 0)
+    {
+        shared_pool<T>.reset();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** recursive quicksort. one half is spawned as a child task, the other half is sorted by the calling task, which then helps until the child finished. */
+template<typename Pool>
+static void nested_sort(Pool& pool, int* first, int* last)
+{
+    if(last - first < 2048)
+    {
+        std::sort(first, last);
+        return;
+    }
+
+    auto pivot = first[(last - first) / 2];
+    auto middle_first = std::partition(first, last, [pivot](int x)
+                                       { return x < pivot; });
+    auto middle_last = std::partition(middle_first, last, [pivot](int x)
+                                      { return !(pivot < x); });
+
+    concurrency_utils::task_group children;
+    pool.spawn(children, [&pool, first, middle_first]()
+               { nested_sort(pool, first, middle_first); });
+    nested_sort(pool, middle_last, last);
+    pool.wait_for(children);
+}
+
+/** nested parallelism: sort a vector with nested_sort, started as a single task. */
+template<typename T>
+static void bench_nested_sort(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(hardware_threads())};
+
+    std::vector<int> input(state.range(0));
+    std::mt19937 rng{42};
+    for(auto& it: input)
+    {
+        it = static_cast<int>(rng());
+    }
+
+    std::vector<int> data;
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        data = input;
+        state.ResumeTiming();
+
+        pool.push_task([&pool, &data]()
+                       { nested_sort(pool, data.data(), data.data() + data.size()); });
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+/** grow the pool by one worker and shrink it again. range(0) selects resize (1) or the full teardown of reset (0). */
+template<typename T>
+static void bench_resize(benchmark::State& state)
+{
+    const std::size_t base = std::max<std::size_t>(hardware_threads(), 2);
+    concurrency_utils::deferred_thread_pool<T> pool{base};
+
+    const bool in_place = state.range(0) != 0;
+    for(auto _: state)
+    {
+        for(auto n: {base + 1, base})
+        {
+            if(in_place)
+            {
+                pool.resize(n);
+            }
+            else
+            {
+                pool.reset(n);
+            }
+            pool.push_task(example_task);
+            pool.run_tasks_and_wait();
+        }
+    }
+}
+
+/** hand items from one dedicated thread to another through a queue, as between two pipeline stages. */
+template<typename T>
+static void bench_handoff(benchmark::State& state)
+{
+    const std::size_t item_count = state.range(0);
+    for(auto _: state)
+    {
+        T queue;
+        std::thread producer{[&queue, item_count]()
+                             {
+                                 for(std::size_t i = 0; i < item_count; ++i)
+                                 {
+                                     queue.push(i);
+                                 }
+                             }};
+
+        std::size_t item = 0;
+        std::size_t sum = 0;
+        for(std::size_t received = 0; received < item_count;)
+        {
+            if(queue.try_pop(item))
+            {
+                sum += item;
+                ++received;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+
+        producer.join();
+    }
+
+    state.SetItemsProcessed(state.iterations() * item_count);
+}
+
+/** run a source, a transforming stage and a sink as a pipeline. */
+static void bench_pipeline(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<concurrency_utils::spmc_queue<std::function<void()>>> pool{3};
+
+    const std::size_t item_count = state.range(0);
+    for(auto _: state)
+    {
+        std::size_t next = 0;
+        std::size_t sum = 0;
+        auto p = concurrency_utils::make_pipeline(
+          1024,
+          [&next, item_count]() -> std::optional<std::size_t>
+          {
+              if(next < item_count)
+              {
+                  return next++;
+              }
+              return std::nullopt;
+          },
+          [](std::size_t v)
+          { return v * 3; },
+          [&sum](std::size_t v)
+          { sum += v; });
+        p.run(pool);
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * item_count);
+}
+
+/** push tasks with a capture too large for the task's inline buffer, which need one heap (or arena) allocation each. */
+template<typename T>
+static void bench_large_captures(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    const auto task_count = static_cast<std::size_t>(state.range(0));
+    std::array<float, 64> weights;
+    weights.fill(0.5f);
+
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task([weights]()
+                           { out.x += weights[0]; });
+        }
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** tasks allocating a scratch buffer, either from the global allocator or from the worker's arena. */
+static void bench_scratch_memory(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<concurrency_utils::spmc_queue<std::function<void()>>> pool{4};
+
+    const bool use_arena = state.range(0) != 0;
+    constexpr std::size_t task_count = 1000;
+    constexpr std::size_t scratch_size = 256;
+
+    for(auto _: state)
+    {
+        for(std::size_t i = 0; i < task_count; ++i)
+        {
+            pool.push_task([use_arena]()
+                           {
+                               if(use_arena)
+                               {
+                                   std::vector<float, concurrency_utils::arena_allocator<float>> scratch(
+                                     scratch_size, 1.0f, concurrency_utils::arena_allocator<float>{concurrency_utils::this_worker::arena()});
+                                   out.x += scratch[0];
+                               }
+                               else
+                               {
+                                   std::vector<float> scratch(scratch_size, 1.0f);
+                                   out.x += scratch[0];
+                               } });
+        }
+        pool.run_tasks_and_wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * task_count);
+}
+
+/** many small back-to-back runs, as in the stress test (20 runs of 250 tasks). the argument selects the idle policy: 0 parks immediately, 1 spins 1024 rounds, 2 spins for up to 50 microseconds. */
+template<typename T>
+static void bench_back_to_back(benchmark::State& state)
+{
+    concurrency_utils::deferred_thread_pool<T> pool{4};
+
+    const concurrency_utils::idle_policy policies[] = {
+      {0, std::chrono::nanoseconds{0}},
+      {1024, std::chrono::nanoseconds{0}},
+      {std::size_t{1} << 30, std::chrono::microseconds{50}}};
+    pool.set_idle_policy(policies[state.range(0)]);
+
+    constexpr std::size_t run_count = 20;
+    constexpr std::size_t task_count = 250;
+    for(auto _: state)
+    {
+        for(std::size_t r = 0; r < run_count; ++r)
+        {
+            for(std::size_t i = 0; i < task_count; ++i)
+            {
+                pool.push_task([]()
+                               { example_task(); });
+            }
+            pool.run_tasks_and_wait();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * run_count * task_count);
+}
+
+/** number of vectors processed by bench_transform. */
+constexpr std::size_t transform_vectors = std::size_t{1} << 14;
+
+/** vectors stored per element of the input of bench_transform. */
+template<typename T>
+constexpr std::size_t vectors_per_element = 1;
+
+template<std::size_t N>
+constexpr std::size_t vectors_per_element<vec4_soa<N>> = N;
+
+/** compute-dense tasks: run the example calculation on a set of vectors through parallel_transform. T is vec4, vec4_simd or a vec4_soa batch. */
+template<typename T>
+static void bench_transform(benchmark::State& state)
+{
+    using pool_type = concurrency_utils::deferred_thread_pool<concurrency_utils::spmc_queue<std::function<void()>>>;
+    pool_type pool{static_cast<std::size_t>(state.range(0))};
+
+    constexpr auto element_count = transform_vectors / vectors_per_element<T>;
+    std::vector<T> in(element_count);
+    std::vector<T> results(element_count);
+
+    vec4 start{1, 0, 0, 0};
+    for(auto& it: in)
+    {
+        if constexpr(vectors_per_element<T> == 1)
+        {
+            it = T{start.x, start.y, start.z, start.w};
+        }
+        else
+        {
+            it.fill(start);
+        }
+    }
+
+    for(auto _: state)
+    {
+        concurrency_utils::parallel_transform(pool, in.data(), in.data() + in.size(), results.data(), [](const T& v)
+                                              {
+                                                  if constexpr(vectors_per_element<T> == 1)
+                                                  {
+                                                      return example_kernel(v);
+                                                  }
+                                                  else
+                                                  {
+                                                      return example_kernel_soa(v);
+                                                  } });
+        benchmark::DoNotOptimize(results.data());
+    }
+
+    // one item is one step of the calculation on one vector.
+    state.SetItemsProcessed(state.iterations() * transform_vectors * block_size * block_size);
+}
+
+/** implementations compared by the algorithm benchmarks. */
+enum algorithm_impl
+{
+    /** the sequential standard algorithm. */
+    sequential = 0,
+
+    /** concurrency_utils/algorithms.h on a deferred_thread_pool. */
+    pool_algorithm = 1,
+
+    /** the standard algorithm with std::execution::par. */
+    parallel_stl = 2
+};
+
+/** register the implementations for two input sizes. */
+static void algorithm_impls(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({"impl", "n"});
+    for(std::int64_t n: {1 << 16, 1 << 22})
+    {
+        for(std::int64_t impl: {sequential, pool_algorithm, parallel_stl})
+        {
+            b->Args({impl, n});
+        }
+    }
+}
+
+/** skip the benchmark if std::execution::par is not available. returns true if the benchmark was skipped. */
+static bool skip_unavailable(benchmark::State& state)
+{
+#if !defined(CONCURRENCY_UTILS_HAS_PARALLEL_STL)
+    if(state.range(0) == parallel_stl)
+    {
+        state.SkipWithError("std::execution::par is not available");
+        return true;
+    }
+#endif
+    return false;
+}
+
+/** random input for the algorithm benchmarks. */
+static std::vector<int> random_ints(std::size_t n)
+{
+    std::vector<int> v(n);
+    std::mt19937 rng{42};
+    for(auto& it: v)
+    {
+        it = static_cast<int>(rng());
+    }
+    return v;
+}
+
+/** sort random integers. */
+template<typename T>
+static void bench_sort(benchmark::State& state)
+{
+    if(skip_unavailable(state))
+    {
+        return;
+    }
+
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(hardware_threads())};
+    const auto input = random_ints(state.range(1));
+
+    std::vector<int> data;
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        data = input;
+        state.ResumeTiming();
+
+        switch(state.range(0))
+        {
+        case sequential:
+            std::sort(data.begin(), data.end());
+            break;
+        case pool_algorithm:
+            concurrency_utils::parallel_sort(pool, data.begin(), data.end());
+            break;
+#if defined(CONCURRENCY_UTILS_HAS_PARALLEL_STL)
+        case parallel_stl:
+            std::sort(std::execution::par, data.begin(), data.end());
+            break;
+#endif
+        }
+        benchmark::DoNotOptimize(data.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+/** inclusive prefix sums of integers. */
+template<typename T>
+static void bench_inclusive_scan(benchmark::State& state)
+{
+    if(skip_unavailable(state))
+    {
+        return;
+    }
+
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(hardware_threads())};
+    const auto input = random_ints(state.range(1));
+    std::vector<int> sums(input.size());
+
+    for(auto _: state)
+    {
+        switch(state.range(0))
+        {
+        case sequential:
+            std::inclusive_scan(input.begin(), input.end(), sums.begin());
+            break;
+        case pool_algorithm:
+            concurrency_utils::parallel_inclusive_scan(pool, input.data(), input.data() + input.size(), sums.data());
+            break;
+#if defined(CONCURRENCY_UTILS_HAS_PARALLEL_STL)
+        case parallel_stl:
+            std::inclusive_scan(std::execution::par, input.begin(), input.end(), sums.begin());
+            break;
+#endif
+        }
+        benchmark::DoNotOptimize(sums.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * input.size());
+    state.SetBytesProcessed(state.iterations() * input.size() * 2 * sizeof(int));
+}
+
+/** sum of squares, as an example of a transform followed by a reduction. */
+template<typename T>
+static void bench_transform_reduce(benchmark::State& state)
+{
+    if(skip_unavailable(state))
+    {
+        return;
+    }
+
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(hardware_threads())};
+    const auto input = random_ints(state.range(1));
+
+    auto square = [](int x) -> std::int64_t
+    { return static_cast<std::int64_t>(x) * x; };
+
+    for(auto _: state)
+    {
+        std::int64_t result = 0;
+        switch(state.range(0))
+        {
+        case sequential:
+            result = std::transform_reduce(input.begin(), input.end(), std::int64_t{0}, std::plus<>{}, square);
+            break;
+        case pool_algorithm:
+            result = concurrency_utils::parallel_transform_reduce(pool, input.data(), input.data() + input.size(), std::int64_t{0}, std::plus<>{}, square);
+            break;
+#if defined(CONCURRENCY_UTILS_HAS_PARALLEL_STL)
+        case parallel_stl:
+            result = std::transform_reduce(std::execution::par, input.begin(), input.end(), std::int64_t{0}, std::plus<>{}, square);
+            break;
+#endif
+        }
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+/** copy the (about) half of the integers which are even. */
+template<typename T>
+static void bench_copy_if(benchmark::State& state)
+{
+    if(skip_unavailable(state))
+    {
+        return;
+    }
+
+    concurrency_utils::deferred_thread_pool<T> pool{static_cast<std::size_t>(hardware_threads())};
+    const auto input = random_ints(state.range(1));
+    std::vector<int> selected(input.size());
+
+    auto is_even = [](int x)
+    { return x % 2 == 0; };
+
+    for(auto _: state)
+    {
+        switch(state.range(0))
+        {
+        case sequential:
+            std::copy_if(input.begin(), input.end(), selected.begin(), is_even);
+            break;
+        case pool_algorithm:
+            concurrency_utils::parallel_copy_if(pool, input.data(), input.data() + input.size(), selected.data(), is_even);
+            break;
+#if defined(CONCURRENCY_UTILS_HAS_PARALLEL_STL)
+        case parallel_stl:
+            std::copy_if(std::execution::par, input.begin(), input.end(), selected.begin(), is_even);
+            break;
+#endif
+        }
+        benchmark::DoNotOptimize(selected.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+/** a counter of its natural size. neighbouring counters share a cache line. */
+struct packed_counter
+{
+    std::atomic_size_t value{0};
+};
+
+/** a counter on its own cache line. */
+struct alignas(concurrency_utils::cache_line_size) padded_counter
+{
+    std::atomic_size_t value{0};
+};
+
+/**
+ * every thread increments its own counter. shows the cost of false sharing between the counters. this is a proxy for the
+ * padding of the pool's and spmc_queue's hot fields (e.g. spmc_queue::next_slot, which every consumer writes, next to the
+ * data vector, which every consumer reads); it does not measure the pool itself, see bench_thread_count for that.
+ */
+template<typename C>
+static void bench_counter_layout(benchmark::State& state)
+{
+    static C counters[64];
+    auto& counter = counters[state.thread_index() % 64];
+
+    for(auto _: state)
+    {
+        for(int i = 0; i < 1000; ++i)
+        {
+            counter.value.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::spmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::work_stealing_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::mpmc_bounded_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::mpmc_segmented_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::spmc_queue<concurrency_utils::inplace_task<>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::work_stealing_queue<concurrency_utils::inplace_task<>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_bounded_overflow, concurrency_utils::mpmc_bounded_queue<std::function<void()>>)->ArgName("capacity")->Arg(64)->Arg(1024)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_queue_bulk, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue_bulk, concurrency_utils::spmc_queue<concurrency_utils::inplace_task<>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue_bulk, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_queue_bulk, concurrency_utils::work_stealing_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_batch_replay, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(100)->Arg(250)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_batch_replay, concurrency_utils::spmc_queue<concurrency_utils::inplace_task<>>)->Arg(100)->Arg(250)->Arg(1000)->Arg(10000)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_parallel_for, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_parallel_for, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_parallel_for, concurrency_utils::work_stealing_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_thread_count, concurrency_utils::spmc_queue<std::function<void()>>)->ArgNames({"threads", "tasks"})->Args({4, 10000})->Args({16, 10000})->Args({32, 10000})->UseRealTime();
+BENCHMARK_TEMPLATE(bench_thread_count, concurrency_utils::work_stealing_queue<std::function<void()>>)->ArgNames({"threads", "tasks"})->Args({4, 10000})->Args({16, 10000})->Args({32, 10000})->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_placement, concurrency_utils::spmc_queue<std::function<void()>>)->ArgName("placement")->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_placement, concurrency_utils::work_stealing_queue<std::function<void()>>)->ArgName("placement")->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_stage_barriers, concurrency_utils::spmc_queue<std::function<void()>>)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_task_graph, concurrency_utils::spmc_queue<std::function<void()>>)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_task_graph, concurrency_utils::work_stealing_queue<std::function<void()>>)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_urgent_latency, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->UseManualTime()->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bench_urgent_latency, concurrency_utils::priority_lane_queue<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>)->UseManualTime()->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bench_urgent_latency, concurrency_utils::priority_lane_queue<concurrency_utils::spmc_queue<std::function<void()>>, 2, 64>)->UseManualTime()->Arg(1000)->Arg(10000);
+
+BENCHMARK_TEMPLATE(bench_continuous, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_continuous, concurrency_utils::mpmc_bounded_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_continuous, concurrency_utils::mpmc_segmented_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_continuous, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_continuous_latency, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_continuous_latency, concurrency_utils::mpmc_bounded_queue<std::function<void()>>)->UseRealTime();
+
+#if defined(CONCURRENCY_UTILS_HAS_COROUTINES)
+BENCHMARK_TEMPLATE(bench_coroutine_hops, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_coroutine_hops, concurrency_utils::mpmc_bounded_queue<std::coroutine_handle<>>)->Arg(100)->Arg(1000)->UseRealTime();
+#endif
+
+BENCHMARK_TEMPLATE(bench_thread_sweep, concurrency_utils::spmc_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_thread_sweep, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_thread_sweep, concurrency_utils::work_stealing_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_thread_sweep, concurrency_utils::mpmc_bounded_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_thread_sweep, concurrency_utils::mpmc_segmented_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_task_granularity, concurrency_utils::spmc_queue<std::function<void()>>)->ArgName("task_ns")->RangeMultiplier(10)->Range(100, 1'000'000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_task_granularity, concurrency_utils::work_stealing_queue<std::function<void()>>)->ArgName("task_ns")->RangeMultiplier(10)->Range(100, 1'000'000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_task_granularity, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->ArgName("task_ns")->RangeMultiplier(10)->Range(100, 1'000'000)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_empty_tasks, concurrency_utils::spmc_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_empty_tasks, concurrency_utils::spmc_queue<concurrency_utils::inplace_task<>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_empty_tasks, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_empty_tasks, concurrency_utils::work_stealing_queue<concurrency_utils::inplace_task<>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_empty_tasks, concurrency_utils::mpmc_bounded_queue<concurrency_utils::inplace_task<>>)->Apply(thread_sweep)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_queue_ops, concurrency_utils::spmc_queue<std::function<void()>>);
+BENCHMARK_TEMPLATE(bench_queue_ops, concurrency_utils::spmc_queue<concurrency_utils::inplace_task<>>);
+BENCHMARK_TEMPLATE(bench_queue_ops, concurrency_utils::spmc_blocking_queue<concurrency_utils::inplace_task<>>);
+BENCHMARK_TEMPLATE(bench_queue_ops, concurrency_utils::mpmc_blocking_queue<concurrency_utils::inplace_task<>>);
+BENCHMARK_TEMPLATE(bench_queue_ops, concurrency_utils::work_stealing_queue<concurrency_utils::inplace_task<>>);
+BENCHMARK_TEMPLATE(bench_queue_ops, concurrency_utils::mpmc_bounded_queue<concurrency_utils::inplace_task<>>);
+BENCHMARK_TEMPLATE(bench_queue_ops, concurrency_utils::mpmc_segmented_queue<concurrency_utils::inplace_task<>>);
+
+BENCHMARK_TEMPLATE(bench_memory_bound, concurrency_utils::spmc_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_memory_bound, concurrency_utils::work_stealing_queue<std::function<void()>>)->Apply(thread_sweep)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_push_latency, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->UseManualTime();
+BENCHMARK_TEMPLATE(bench_push_latency, concurrency_utils::mpmc_bounded_queue<std::function<void()>>)->UseManualTime();
+BENCHMARK_TEMPLATE(bench_push_latency, concurrency_utils::mpmc_segmented_queue<std::function<void()>>)->UseManualTime();
+BENCHMARK_TEMPLATE(bench_push_latency, concurrency_utils::priority_lane_queue<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>)->UseManualTime();
+
+BENCHMARK_TEMPLATE(bench_multi_producer, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_multi_producer, concurrency_utils::mpmc_bounded_queue<std::function<void()>>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_multi_producer, concurrency_utils::mpmc_segmented_queue<std::function<void()>>)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_nested_sort, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(1 << 16)->Arg(1 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_nested_sort, concurrency_utils::work_stealing_queue<std::function<void()>>)->Arg(1 << 16)->Arg(1 << 20)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_resize, concurrency_utils::spmc_queue<std::function<void()>>)->ArgName("in_place")->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_handoff, concurrency_utils::spsc_ring<std::size_t>)->Arg(1 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_handoff, concurrency_utils::mpmc_bounded_queue<std::size_t>)->Arg(1 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_handoff, concurrency_utils::mpmc_blocking_queue<std::size_t>)->Arg(1 << 20)->UseRealTime();
+BENCHMARK(bench_pipeline)->Arg(1 << 16)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_large_captures, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_large_captures, concurrency_utils::spmc_queue<concurrency_utils::arena_task<>>)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK(bench_scratch_memory)->ArgName("arena")->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_back_to_back, concurrency_utils::spmc_queue<std::function<void()>>)->ArgName("idle")->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_back_to_back, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->ArgName("idle")->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_transform, vec4)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_transform, vec4_simd)->Apply(thread_sweep)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_transform, vec4_soa<16>)->Apply(thread_sweep)->UseRealTime();
+
+BENCHMARK_TEMPLATE(bench_sort, concurrency_utils::spmc_queue<std::function<void()>>)->Apply(algorithm_impls)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_inclusive_scan, concurrency_utils::spmc_queue<std::function<void()>>)->Apply(algorithm_impls)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_transform_reduce, concurrency_utils::spmc_queue<std::function<void()>>)->Apply(algorithm_impls)->UseRealTime();
+BENCHMARK_TEMPLATE(bench_copy_if, concurrency_utils::spmc_queue<std::function<void()>>)->Apply(algorithm_impls)->UseRealTime();
 
-BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::spmc_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000);
-BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::spmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000);
-BENCHMARK_TEMPLATE(bench_queue, concurrency_utils::mpmc_blocking_queue<std::function<void()>>)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bench_counter_layout, packed_counter)->Threads(1)->Threads(4)->Threads(16)->Threads(32);
+BENCHMARK_TEMPLATE(bench_counter_layout, padded_counter)->Threads(1)->Threads(4)->Threads(16)->Threads(32);
 
 BENCHMARK_MAIN();
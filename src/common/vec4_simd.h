@@ -0,0 +1,288 @@
+/**
+ * concurrency_utils - concurrency utility library
+ *
+ * vectorized counterparts of vec4 used in the benchmarks: an SSE-backed vec4 and a structure-of-arrays batch of vectors,
+ * which processes 4 (SSE) or 8 (AVX) vectors per instruction.
+ *
+ * \author Felix Lubbe
+ * \copyright Copyright (c) 2021
+ * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#if defined(__AVX__)
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#endif
+
+#include "vec4.h"
+
+/*
+ * float_pack: a register of floats, one lane per vector of a vec4_soa.
+ */
+
+#if defined(__AVX__)
+
+struct float_pack
+{
+    static constexpr std::size_t width = 8;
+
+    __m256 v;
+
+    static float_pack load(const float* p)
+    {
+        return {_mm256_load_ps(p)};
+    }
+    static float_pack broadcast(float f)
+    {
+        return {_mm256_set1_ps(f)};
+    }
+    void store(float* p) const
+    {
+        _mm256_store_ps(p, v);
+    }
+
+    const float_pack operator+(const float_pack& other) const
+    {
+        return {_mm256_add_ps(v, other.v)};
+    }
+    const float_pack operator-(const float_pack& other) const
+    {
+        return {_mm256_sub_ps(v, other.v)};
+    }
+    const float_pack operator*(const float_pack& other) const
+    {
+        return {_mm256_mul_ps(v, other.v)};
+    }
+
+    /** 1/sqrt(v), and 1 for lanes which are zero (as vec4::one_over_length). */
+    const float_pack one_over_sqrt() const
+    {
+        auto one = _mm256_set1_ps(1.0f);
+        auto zero = _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_EQ_OQ);
+        auto r = _mm256_div_ps(one, _mm256_sqrt_ps(v));
+        return {_mm256_blendv_ps(r, one, zero)};
+    }
+};
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct float_pack
+{
+    static constexpr std::size_t width = 4;
+
+    __m128 v;
+
+    static float_pack load(const float* p)
+    {
+        return {_mm_load_ps(p)};
+    }
+    static float_pack broadcast(float f)
+    {
+        return {_mm_set1_ps(f)};
+    }
+    void store(float* p) const
+    {
+        _mm_store_ps(p, v);
+    }
+
+    const float_pack operator+(const float_pack& other) const
+    {
+        return {_mm_add_ps(v, other.v)};
+    }
+    const float_pack operator-(const float_pack& other) const
+    {
+        return {_mm_sub_ps(v, other.v)};
+    }
+    const float_pack operator*(const float_pack& other) const
+    {
+        return {_mm_mul_ps(v, other.v)};
+    }
+
+    /** 1/sqrt(v), and 1 for lanes which are zero (as vec4::one_over_length). */
+    const float_pack one_over_sqrt() const
+    {
+        auto one = _mm_set1_ps(1.0f);
+        auto zero = _mm_cmpeq_ps(v, _mm_setzero_ps());
+        auto r = _mm_div_ps(one, _mm_sqrt_ps(v));
+        return {_mm_or_ps(_mm_and_ps(zero, one), _mm_andnot_ps(zero, r))};
+    }
+};
+
+#else
+
+struct float_pack
+{
+    static constexpr std::size_t width = 1;
+
+    float v;
+
+    static float_pack load(const float* p)
+    {
+        return {*p};
+    }
+    static float_pack broadcast(float f)
+    {
+        return {f};
+    }
+    void store(float* p) const
+    {
+        *p = v;
+    }
+
+    const float_pack operator+(const float_pack& other) const
+    {
+        return {v + other.v};
+    }
+    const float_pack operator-(const float_pack& other) const
+    {
+        return {v - other.v};
+    }
+    const float_pack operator*(const float_pack& other) const
+    {
+        return {v * other.v};
+    }
+
+    /** 1/sqrt(v), and 1 for zero (as vec4::one_over_length). */
+    const float_pack one_over_sqrt() const
+    {
+        return {v == 0 ? 1.0f : 1.0f / std::sqrt(v)};
+    }
+};
+
+#endif
+
+/*
+ * vec4_simd: a vec4 held in a single SSE register.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+struct vec4_simd
+{
+    __m128 v{_mm_setzero_ps()};
+
+    vec4_simd() = default;
+
+    vec4_simd(__m128 in_v)
+    : v{in_v}
+    {
+    }
+
+    vec4_simd(float in_x, float in_y, float in_z, float in_w = 0.f)
+    : v{_mm_set_ps(in_w, in_z, in_y, in_x)}
+    {
+    }
+
+    explicit vec4_simd(const vec4& other)
+    : vec4_simd{other.x, other.y, other.z, other.w}
+    {
+    }
+
+    float length_squared() const
+    {
+        return dot_product(*this);
+    }
+
+    float one_over_length() const
+    {
+        auto len_sq = length_squared();
+        if(len_sq == 0)
+        {
+            return 1.0f;
+        }
+
+        return 1.0f / std::sqrt(len_sq);
+    }
+
+    /** horizontal sum of the component-wise product, using SSE2 shuffles only. */
+    float dot_product(const vec4_simd& other) const
+    {
+        auto m = _mm_mul_ps(v, other.v);
+        auto s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        s = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(s);
+    }
+
+    void normalize()
+    {
+        *this = *this * one_over_length();
+    }
+    const vec4_simd normalized() const
+    {
+        return *this * one_over_length();
+    }
+
+    /* operations. */
+    const vec4_simd operator+(const vec4_simd& other) const
+    {
+        return {_mm_add_ps(v, other.v)};
+    }
+    const vec4_simd operator-(const vec4_simd& other) const
+    {
+        return {_mm_sub_ps(v, other.v)};
+    }
+    const vec4_simd operator*(float s) const
+    {
+        return {_mm_mul_ps(v, _mm_set1_ps(s))};
+    }
+};
+
+#else
+
+/* no SSE: fall back to the scalar type. */
+using vec4_simd = vec4;
+
+#endif
+
+/*
+ * vec4_soa: a batch of N vectors, stored component-wise.
+ */
+
+/**
+ * N vectors stored as four arrays of components, so that one float_pack holds the same component of float_pack::width
+ * vectors. N has to be a multiple of the pack width. the arrays are aligned for aligned loads and start on a cache line.
+ */
+template<std::size_t N>
+struct alignas(64) vec4_soa
+{
+    static_assert(N % float_pack::width == 0, "vec4_soa: N has to be a multiple of the SIMD width.");
+
+    static constexpr std::size_t size = N;
+
+    alignas(32) float x[N];
+    alignas(32) float y[N];
+    alignas(32) float z[N];
+    alignas(32) float w[N];
+
+    /** set all vectors to v. */
+    void fill(const vec4& v)
+    {
+        for(std::size_t i = 0; i < N; ++i)
+        {
+            x[i] = v.x;
+            y[i] = v.y;
+            z[i] = v.z;
+            w[i] = v.w;
+        }
+    }
+
+    /** return the i-th vector. */
+    vec4 get(std::size_t i) const
+    {
+        return {x[i], y[i], z[i], w[i]};
+    }
+
+    /** set the i-th vector. */
+    void set(std::size_t i, const vec4& v)
+    {
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+        w[i] = v.w;
+    }
+};
@@ -1,25 +1,47 @@
 /**
  * concurrency_utils - concurrency utility library
- * 
- * thread pool test.
- * 
+ *
+ * thread pool test. checks that every task runs exactly once, for every queue type and push path, compares the parallel
+ * algorithms against the sequential ones, and optionally measures the throughput and the p99 batch latency and compares
+ * them against a recorded baseline.
+ *
  * \author Felix Lubbe
  * \copyright Copyright (c) 2021
  * \license Distributed under the MIT software license (see accompanying LICENSE.txt).
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <exception>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "fmt/format.h"
 
 #include "concurrency_utils/thread_pool.h"
+#include "concurrency_utils/algorithms.h"
+#include "concurrency_utils/continuous_thread_pool.h"
+#include "concurrency_utils/coroutine.h"
+#include "concurrency_utils/parallel.h"
+#include "concurrency_utils/queue.h"
+#include "concurrency_utils/task_batch.h"
 #include "../common/vec4.h"
 
-/** duration of thread pool throughput benchmark */
-constexpr float benchmark_time = 1000;
-
-/** global variable to perform random calculation in example task. don't expect this to hold any valid value (also due to possible concurrent reads/writes). */
-vec4 out{1, 0, 0, 0};
+/** per-thread variable to perform random calculation in example task. don't expect this to hold any valid value. thread-local, so that the workers do not race on it. */
+thread_local vec4 out{1, 0, 0, 0};
 
 /** some normalized vector used in the calculations. */
 const vec4 l{0.5f, 0.5f, 0.70710678f};
@@ -47,52 +69,879 @@ void example_task()
     }
 }
 
-/** program entry point. */
-int main(int argc, char* argv[])
+/*
+ * command line.
+ */
+
+/** test parameters. */
+struct options
+{
+    /** number of worker threads. */
+    std::size_t thread_count{4};
+
+    /** tasks per batch. */
+    std::size_t tasks{250};
+
+    /** batches per correctness check. */
+    std::size_t iterations{20};
+
+    /** whether to run the performance measurement. */
+    bool perf{false};
+
+    /** batches per performance measurement. */
+    std::size_t batches{200};
+
+    /** file to write the measured performance to. */
+    std::string record_path;
+
+    /** file to compare the measured performance against. */
+    std::string baseline_path;
+
+    /** allowed relative deviation from the baseline. */
+    double tolerance{0.25};
+};
+
+/** print usage information. */
+void print_usage()
+{
+    fmt::print("usage: test_thread_pool [--threads=n] [--tasks=n] [--iterations=n]\n"
+               "                        [--perf] [--batches=n] [--record=file] [--baseline=file] [--tolerance=f]\n"
+               "\n"
+               "checks that every task runs exactly once, for all queue types. with --perf, also measures the\n"
+               "throughput and the p99 batch latency of every queue type (best of 3 rounds). --record writes the results\n"
+               "to a file, --baseline fails if the throughput dropped (or the latency grew) by more than the tolerance\n"
+               "(default 0.25).\n");
+}
+
+/** parse the command line. returns false on invalid arguments. */
+bool parse_options(int argc, char* argv[], options& opts)
+{
+    auto value_of = [](const std::string& arg, const std::string& name, std::string& value) -> bool
+    {
+        if(arg.compare(0, name.size(), name) != 0)
+        {
+            return false;
+        }
+        value = arg.substr(name.size());
+        return true;
+    };
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        std::string value;
+
+        try
+        {
+            if(value_of(arg, "--threads=", value))
+            {
+                opts.thread_count = std::stoul(value);
+            }
+            else if(value_of(arg, "--tasks=", value))
+            {
+                opts.tasks = std::stoul(value);
+            }
+            else if(value_of(arg, "--iterations=", value))
+            {
+                opts.iterations = std::stoul(value);
+            }
+            else if(value_of(arg, "--batches=", value))
+            {
+                opts.batches = std::stoul(value);
+                opts.perf = true;
+            }
+            else if(value_of(arg, "--record=", value))
+            {
+                opts.record_path = value;
+                opts.perf = true;
+            }
+            else if(value_of(arg, "--baseline=", value))
+            {
+                opts.baseline_path = value;
+                opts.perf = true;
+            }
+            else if(value_of(arg, "--tolerance=", value))
+            {
+                opts.tolerance = std::stod(value);
+            }
+            else if(arg == "--perf")
+            {
+                opts.perf = true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        catch(const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    return opts.thread_count > 0 && opts.tasks > 0 && opts.batches > 0 && opts.tolerance >= 0;
+}
+
+/*
+ * exactly-once checks.
+ */
+
+/** counts the executions of every task of a batch. */
+class execution_counter
+{
+    std::vector<std::atomic_uint32_t> counts;
+
+public:
+    /** constructor. */
+    explicit execution_counter(std::size_t task_count)
+    : counts(task_count)
+    {
+    }
+
+    /** record an execution of the i-th task. */
+    void hit(std::size_t i)
+    {
+        counts[i].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** return the number of tasks. */
+    std::size_t size() const
+    {
+        return counts.size();
+    }
+
+    /** return the number of tasks which did not run exactly once, and reset the counts. */
+    std::size_t check_and_reset()
+    {
+        std::size_t wrong = 0;
+        for(auto& it: counts)
+        {
+            if(it.exchange(0, std::memory_order_relaxed) != 1)
+            {
+                ++wrong;
+            }
+        }
+        return wrong;
+    }
+};
+
+/** a task recording its execution. a named type, so that ranges of tasks can be pushed with push_tasks. */
+struct counted_task
+{
+    execution_counter* counter;
+    std::size_t index;
+
+    void operator()() const
+    {
+        example_task();
+        counter->hit(index);
+    }
+};
+
+/** number of failed checks. */
+std::size_t failed_checks = 0;
+
+/** report the result of a check. */
+void report(const std::string& queue_name, const char* scenario, std::size_t wrong_tasks, std::size_t total_tasks)
+{
+    if(wrong_tasks == 0)
+    {
+        fmt::print("  ok    {:<32} {}\n", queue_name, scenario);
+    }
+    else
+    {
+        fmt::print("  FAIL  {:<32} {}: {} of {} tasks did not run exactly once\n", queue_name, scenario, wrong_tasks, total_tasks);
+        ++failed_checks;
+    }
+}
+
+/** report the result of a check which either passes or fails as a whole. */
+void report_result(const std::string& name, const std::string& scenario, bool ok)
+{
+    if(ok)
+    {
+        fmt::print("  ok    {:<32} {}\n", name, scenario);
+    }
+    else
+    {
+        fmt::print("  FAIL  {:<32} {}: unexpected result\n", name, scenario);
+        ++failed_checks;
+    }
+}
+
+/** run the exactly-once checks for a queue type with the deferred_thread_pool. */
+template<typename queue_type, typename... Args>
+void check_deferred_pool(const std::string& queue_name, const options& opts, Args&&... queue_args)
+{
+    using traits = concurrency_utils::queue_traits<queue_type>;
+
+    concurrency_utils::deferred_thread_pool<queue_type> pool{opts.thread_count, std::forward<Args>(queue_args)...};
+    execution_counter counter{opts.tasks};
+    std::size_t wrong = 0;
+
+    // push_task.
+    for(std::size_t it = 0; it < opts.iterations; ++it)
+    {
+        for(std::size_t i = 0; i < counter.size(); ++i)
+        {
+            pool.push_task(counted_task{&counter, i});
+        }
+        pool.run_tasks_and_wait();
+        wrong += counter.check_and_reset();
+    }
+    report(queue_name, "deferred push_task", wrong, opts.iterations * counter.size());
+
+    // push_tasks.
+    std::vector<counted_task> tasks;
+    for(std::size_t i = 0; i < counter.size(); ++i)
+    {
+        tasks.push_back({&counter, i});
+    }
+
+    wrong = 0;
+    for(std::size_t it = 0; it < opts.iterations; ++it)
+    {
+        pool.push_tasks(tasks);
+        pool.run_tasks_and_wait();
+        wrong += counter.check_and_reset();
+    }
+    report(queue_name, "deferred push_tasks", wrong, opts.iterations * counter.size());
+
+    // spawn from running tasks. every parent spawns a block of the tasks and waits for them.
+    constexpr std::size_t parent_count = 8;
+    wrong = 0;
+    for(std::size_t it = 0; it < opts.iterations; ++it)
+    {
+        for(std::size_t p = 0; p < parent_count; ++p)
+        {
+            pool.push_task([&pool, &counter, p]()
+                           {
+                               concurrency_utils::task_group group;
+                               for(std::size_t i = counter.size() * p / parent_count; i < counter.size() * (p + 1) / parent_count; ++i)
+                               {
+                                   pool.spawn(group, counted_task{&counter, i});
+                               }
+                               pool.wait_for(group);
+                           });
+        }
+        pool.run_tasks_and_wait();
+        wrong += counter.check_and_reset();
+    }
+    report(queue_name, "deferred spawn", wrong, opts.iterations * counter.size());
+
+    // push_priority_task, alternating between the highest and the lowest lane.
+    if constexpr(traits::has_priorities)
+    {
+        wrong = 0;
+        for(std::size_t it = 0; it < opts.iterations; ++it)
+        {
+            for(std::size_t i = 0; i < counter.size(); ++i)
+            {
+                pool.push_priority_task(i % 2 == 0 ? 0 : queue_type::lowest_priority, counted_task{&counter, i});
+            }
+            pool.run_tasks_and_wait();
+            wrong += counter.check_and_reset();
+        }
+        report(queue_name, "deferred push_priority_task", wrong, opts.iterations * counter.size());
+    }
+
+    // push_immediate_task, i.e. pushes while the workers are running.
+    if constexpr(traits::is_multi_producer)
+    {
+        wrong = 0;
+        for(std::size_t it = 0; it < opts.iterations; ++it)
+        {
+            for(std::size_t i = 0; i < counter.size(); ++i)
+            {
+                pool.push_immediate_task(counted_task{&counter, i});
+            }
+            pool.run_tasks_and_wait();
+            wrong += counter.check_and_reset();
+        }
+        report(queue_name, "deferred push_immediate_task", wrong, opts.iterations * counter.size());
+    }
+}
+
+/** check that replaying a task_batch runs every recorded task exactly once, also if some of them throw. */
+void check_task_batch(const options& opts)
+{
+    concurrency_utils::deferred_thread_pool<concurrency_utils::spmc_queue<std::function<void()>>> pool{opts.thread_count};
+    execution_counter counter{opts.tasks};
+
+    // every 16th task throws after recording its execution.
+    concurrency_utils::task_batch<std::function<void()>> batch;
+    std::size_t throwing = 0;
+    for(std::size_t i = 0; i < counter.size(); ++i)
+    {
+        if(i % 16 == 0)
+        {
+            batch.add([&counter, i]()
+                      {
+                          counter.hit(i);
+                          throw std::runtime_error{"recorded task failed"};
+                      });
+            ++throwing;
+        }
+        else
+        {
+            batch.add(counted_task{&counter, i});
+        }
+    }
+
+    std::size_t wrong = 0;
+    bool all_reported = true;
+    for(std::size_t it = 0; it < opts.iterations; ++it)
+    {
+        std::size_t reported = 0;
+        try
+        {
+            pool.run(batch);
+        }
+        catch(const concurrency_utils::task_errors& e)
+        {
+            reported = e.exceptions().size();
+        }
+        all_reported = all_reported && reported == throwing;
+        wrong += counter.check_and_reset();
+    }
+    report("task_batch", "replay with throwing tasks", wrong, opts.iterations * counter.size());
+    report_result("task_batch", "replay reports every exception", all_reported);
+}
+
+/** run the exactly-once checks for a queue type with the continuous_thread_pool, pushing from two threads. */
+template<typename queue_type, typename... Args>
+void check_continuous_pool(const std::string& queue_name, const options& opts, Args&&... queue_args)
 {
-    fmt::print("spmc queue thread pool stress test. press CTRL-C to exit.\n");
+    concurrency_utils::continuous_thread_pool<queue_type> pool{opts.thread_count, std::forward<Args>(queue_args)...};
+    execution_counter counter{opts.tasks};
+    std::size_t wrong = 0;
+
+    for(std::size_t it = 0; it < opts.iterations; ++it)
+    {
+        auto push_range = [&pool, &counter](std::size_t first, std::size_t last)
+        {
+            for(std::size_t i = first; i < last; ++i)
+            {
+                pool.push_task(counted_task{&counter, i});
+            }
+        };
+
+        std::thread producer{push_range, 0, counter.size() / 2};
+        push_range(counter.size() / 2, counter.size());
+        producer.join();
+
+        pool.wait_idle();
+        wrong += counter.check_and_reset();
+    }
+    report(queue_name, "continuous push_task", wrong, opts.iterations * counter.size());
+}
 
-    constexpr auto thread_count = 4;
-    constexpr auto tasks = 250;
-    constexpr auto iterations = 20;
+/*
+ * parallel algorithms.
+ */
+
+/**
+ * input sizes for an algorithm on elements of type T: empty and tiny ranges, ranges just below and above the two-block
+ * cutoff below which the calling thread does all the work, one block per worker, and an odd number of blocks.
+ */
+template<typename T>
+std::vector<std::size_t> algorithm_sizes(std::size_t thread_count)
+{
+    const auto block = concurrency_utils::detail::min_block_elements<T>();
+    return {0, 1, 2 * block - 1, 2 * block, 2 * block + 1, thread_count * block + 7, 5 * block + 3};
+}
 
-    fmt::print("{} threads, {} tasks, {} iterations\n", thread_count, tasks, iterations);
-    fmt::print("testing...\n");
+/** random integers with duplicates. */
+std::vector<int> random_ints(std::size_t n, std::mt19937& rng)
+{
+    std::vector<int> v(n);
+    for(auto& it: v)
+    {
+        it = static_cast<int>(rng() % 1000) - 500;
+    }
+    return v;
+}
 
-    // create new thread pool
-    concurrency_utils::deferred_thread_pool<concurrency_utils::spmc_queue<std::function<void()>>> dp{thread_count};
+/** check parallel_for and parallel_reduce for every partitioning mode, with and without a grain size. */
+void check_parallel_loops(std::size_t thread_count)
+{
+    concurrency_utils::deferred_thread_pool<concurrency_utils::spmc_queue<std::function<void()>>> pool{thread_count};
+    const auto name = fmt::format("parallel loops ({} threads)", thread_count);
 
-    std::chrono::steady_clock::time_point msec_reference_time{std::chrono::steady_clock::now()};
-    auto start_time = msec_reference_time;
+    const std::pair<concurrency_utils::partition, const char*> modes[] = {
+      {concurrency_utils::partition::static_chunks, "static_chunks"},
+      {concurrency_utils::partition::guided, "guided"},
+      {concurrency_utils::partition::automatic, "automatic"}};
 
-    for(int loop_ctr{0};; ++loop_ctr)
+    for(auto [mode, mode_name]: modes)
     {
-        // on each iteration, fill the thread pool with tasks and execute them.
-        for(std::size_t it = 0; it < iterations; ++it)
+        std::size_t wrong = 0;
+        std::size_t total = 0;
+        bool ordered = true;
+        for(std::size_t n: {std::size_t{0}, std::size_t{1}, std::size_t{1000}, std::size_t{12345}})
         {
-            // fill pool with tasks.
-            for(std::size_t i = 0; i < tasks; ++i)
+            for(std::size_t grain: {std::size_t{0}, std::size_t{7}})
             {
-                dp.push_task(example_task);
+                // every index is visited exactly once. begin and end have different types.
+                execution_counter counter{n};
+                concurrency_utils::parallel_for(
+                  pool, 0, n, grain, [&counter](std::size_t i)
+                  { counter.hit(i); },
+                  mode);
+                wrong += counter.check_and_reset();
+                total += n;
+
+                // the partial results are combined in order, so a non-commutative reduction matches the sequential one.
+                std::string expected;
+                for(std::size_t i = 0; i < n; ++i)
+                {
+                    expected += static_cast<char>('a' + i % 26);
+                }
+                auto result = concurrency_utils::parallel_reduce(
+                  pool, std::size_t{0}, n, grain, std::string{},
+                  [](std::string acc, std::size_t i) -> std::string
+                  {
+                      acc += static_cast<char>('a' + i % 26);
+                      return acc;
+                  },
+                  [](std::string a, const std::string& b) -> std::string
+                  { return a + b; },
+                  mode);
+                ordered = ordered && result == expected;
             }
+        }
+        report(name, fmt::format("parallel_for {}", mode_name).c_str(), wrong, total);
+        report_result(name, fmt::format("parallel_reduce {}", mode_name), ordered);
+    }
+}
+
+/** compare the parallel algorithms against the sequential standard algorithms, on a pool with the given number of threads. */
+void check_algorithms(std::size_t thread_count)
+{
+    concurrency_utils::deferred_thread_pool<concurrency_utils::spmc_queue<std::function<void()>>> pool{thread_count};
+    const auto name = fmt::format("algorithms ({} threads)", thread_count);
+    std::mt19937 rng{static_cast<std::uint32_t>(thread_count)};
+
+    // parallel_sort. with an odd number of blocks, a merge round leaves a run without a partner.
+    bool ok = true;
+    for(auto n: algorithm_sizes<int>(thread_count))
+    {
+        auto data = random_ints(n, rng);
+        auto expected = data;
+
+        std::sort(expected.begin(), expected.end());
+        concurrency_utils::parallel_sort(pool, data.begin(), data.end());
+        ok = ok && data == expected;
+
+        std::sort(expected.begin(), expected.end(), std::greater<>{});
+        concurrency_utils::parallel_sort(pool, data.data(), data.data() + data.size(), std::greater<>{});
+        ok = ok && data == expected;
+    }
+    for(auto n: algorithm_sizes<std::string>(thread_count))
+    {
+        std::vector<std::string> data(n);
+        for(auto& it: data)
+        {
+            it = fmt::format("element {:>24}", rng() % 10000);
+        }
+        auto expected = data;
+
+        std::sort(expected.begin(), expected.end());
+        concurrency_utils::parallel_sort(pool, data.begin(), data.end());
+        ok = ok && data == expected;
+    }
+    report_result(name, "parallel_sort", ok);
+
+    // parallel_inclusive_scan, into a separate output and in place.
+    ok = true;
+    for(auto n: algorithm_sizes<std::int64_t>(thread_count))
+    {
+        auto ints = random_ints(n, rng);
+        std::vector<std::int64_t> data(ints.begin(), ints.end());
+        std::vector<std::int64_t> expected(n);
+        std::inclusive_scan(data.begin(), data.end(), expected.begin());
+
+        std::vector<std::int64_t> sums(n);
+        auto sums_end = concurrency_utils::parallel_inclusive_scan(pool, data.data(), data.data() + n, sums.data());
+        ok = ok && sums == expected && sums_end == sums.data() + n;
+
+        concurrency_utils::parallel_inclusive_scan(pool, data.data(), data.data() + n, data.data());
+        ok = ok && data == expected;
+    }
+    report_result(name, "parallel_inclusive_scan", ok);
+
+    // parallel_transform_reduce, with a commutative and a non-commutative reduction.
+    ok = true;
+    for(auto n: algorithm_sizes<int>(thread_count))
+    {
+        auto data = random_ints(n, rng);
+
+        auto square = [](int x) -> std::int64_t
+        { return static_cast<std::int64_t>(x) * x; };
+        auto expected_sum = std::transform_reduce(data.begin(), data.end(), std::int64_t{7}, std::plus<>{}, square);
+        ok = ok && concurrency_utils::parallel_transform_reduce(pool, data.data(), data.data() + n, std::int64_t{7}, std::plus<>{}, square) == expected_sum;
+
+        // string concatenation is associative, but not commutative, so the partial results have to be combined in order.
+        auto to_string = [](int x)
+        { return std::to_string(x) + ","; };
+        std::string expected_text = "[";
+        for(auto x: data)
+        {
+            expected_text += to_string(x);
+        }
+        auto text = concurrency_utils::parallel_transform_reduce(pool, data.data(), data.data() + n, std::string{"["}, std::plus<>{}, to_string);
+        ok = ok && text == expected_text;
+    }
+    report_result(name, "parallel_transform_reduce", ok);
+
+    // parallel_copy_if keeps the order of the selected elements.
+    ok = true;
+    for(auto n: algorithm_sizes<int>(thread_count))
+    {
+        std::vector<int> data(n);
+        std::iota(data.begin(), data.end(), 0);
+        std::shuffle(data.begin(), data.end(), rng);
+
+        auto is_selected = [](int x)
+        { return x % 3 != 0; };
+
+        std::vector<int> expected(n);
+        expected.erase(std::copy_if(data.begin(), data.end(), expected.begin(), is_selected), expected.end());
+
+        std::vector<int> selected(n);
+        auto selected_end = concurrency_utils::parallel_copy_if(pool, data.data(), data.data() + n, selected.data(), is_selected);
+        ok = ok && std::equal(expected.begin(), expected.end(), selected.data(), selected_end);
+    }
+    report_result(name, "parallel_copy_if", ok);
+}
+
+#if defined(CONCURRENCY_UTILS_HAS_COROUTINES)
+
+/*
+ * coroutines.
+ */
+
+/** continue on a worker and return the id of the thread the coroutine was resumed on. */
+template<typename pool_type>
+concurrency_utils::task<std::thread::id> resume_on_worker(pool_type& pool)
+{
+    co_await pool.schedule();
+    co_return std::this_thread::get_id();
+}
+
+/** hop onto the pool once per index in [first, last), recording every resume. returns the number of hops. */
+template<typename pool_type>
+concurrency_utils::task<std::size_t> counted_hops(pool_type& pool, execution_counter& counter, std::size_t first, std::size_t last)
+{
+    std::size_t hops = 0;
+    for(std::size_t i = first; i < last; ++i)
+    {
+        co_await pool.schedule();
+        counter.hit(i);
+        ++hops;
+    }
+    co_return hops;
+}
+
+/** throw from a worker. */
+template<typename pool_type>
+concurrency_utils::task<int> throw_on_worker(pool_type& pool)
+{
+    co_await pool.schedule();
+    throw std::runtime_error{"thrown on a worker"};
+}
+
+/** await a task throwing from a worker. returns whether the exception arrived. */
+template<typename pool_type>
+concurrency_utils::task<bool> catch_from_worker(pool_type& pool)
+{
+    bool caught = false;
+    try
+    {
+        co_await throw_on_worker(pool);
+    }
+    catch(const std::runtime_error&)
+    {
+        caught = true;
+    }
+    co_return caught;
+}
+
+/** check co_await pool.schedule(): coroutines continue on a worker, return values, propagate exceptions, and every hop resumes exactly once. */
+template<typename pool_type, typename... Args>
+void check_coroutines(const std::string& pool_name, const options& opts, Args&&... queue_args)
+{
+    pool_type pool{opts.thread_count, std::forward<Args>(queue_args)...};
+
+    report_result(pool_name, "coroutine continues on a worker", concurrency_utils::sync_wait(resume_on_worker(pool)) != std::this_thread::get_id());
+    report_result(pool_name, "coroutine co_await rethrows", concurrency_utils::sync_wait(catch_from_worker(pool)));
+
+    bool rethrown = false;
+    try
+    {
+        concurrency_utils::sync_wait(throw_on_worker(pool));
+    }
+    catch(const std::runtime_error&)
+    {
+        rethrown = true;
+    }
+    report_result(pool_name, "coroutine sync_wait rethrows", rethrown);
+
+    // two coroutines hop concurrently, so that resumes from the workers and from outside the pool interleave.
+    execution_counter counter{opts.tasks};
+    std::size_t wrong = 0;
+    std::size_t hops = 0;
+    for(std::size_t it = 0; it < opts.iterations; ++it)
+    {
+        std::size_t other_hops = 0;
+        std::thread other{[&pool, &counter, &other_hops]()
+                          { other_hops = concurrency_utils::sync_wait(counted_hops(pool, counter, 0, counter.size() / 2)); }};
+        hops += concurrency_utils::sync_wait(counted_hops(pool, counter, counter.size() / 2, counter.size()));
+        other.join();
+
+        hops += other_hops;
+        wrong += counter.check_and_reset();
+    }
+    report(pool_name, "coroutine hops", wrong, opts.iterations * counter.size());
+    report_result(pool_name, "coroutine hop count", hops == opts.iterations * counter.size());
+}
+
+#endif /* defined(CONCURRENCY_UTILS_HAS_COROUTINES) */
+
+/*
+ * performance measurement.
+ */
+
+/** measured performance of a queue type. */
+struct performance
+{
+    /** tasks per second. */
+    double throughput{0};
+
+    /** 99th percentile of the time to push and run a batch, in microseconds. */
+    double p99_batch_us{0};
+};
+
+/** number of measurements per queue type. the best result is kept, which filters out disturbances by other processes. */
+constexpr std::size_t measurement_rounds = 3;
+
+/** measure the throughput and the batch latency of a queue type with the deferred_thread_pool. */
+template<typename queue_type, typename... Args>
+performance measure(const options& opts, Args&&... queue_args)
+{
+    concurrency_utils::deferred_thread_pool<queue_type> pool{opts.thread_count, std::forward<Args>(queue_args)...};
+
+    auto run_batch = [&pool, &opts]()
+    {
+        for(std::size_t i = 0; i < opts.tasks; ++i)
+        {
+            pool.push_task(example_task);
+        }
+        pool.run_tasks_and_wait();
+    };
+
+    // warm up the workers, the queue and the allocator.
+    for(std::size_t i = 0; i < std::max<std::size_t>(opts.batches / 10, 1); ++i)
+    {
+        run_batch();
+    }
+
+    performance best;
+    std::vector<double> batch_us;
+    batch_us.reserve(opts.batches);
+
+    for(std::size_t round = 0; round < measurement_rounds; ++round)
+    {
+        batch_us.clear();
+
+        auto start_time = std::chrono::steady_clock::now();
+        for(std::size_t i = 0; i < opts.batches; ++i)
+        {
+            auto batch_start = std::chrono::steady_clock::now();
+            run_batch();
+            batch_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - batch_start).count());
+        }
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+        std::sort(batch_us.begin(), batch_us.end());
+        auto p99_index = static_cast<std::size_t>(std::ceil(0.99 * batch_us.size())) - 1;
+
+        auto throughput = static_cast<double>(opts.batches * opts.tasks) / seconds;
+        if(round == 0 || throughput > best.throughput)
+        {
+            best.throughput = throughput;
+        }
+        if(round == 0 || batch_us[p99_index] < best.p99_batch_us)
+        {
+            best.p99_batch_us = batch_us[p99_index];
+        }
+    }
+
+    return best;
+}
+
+/** read a baseline file. every line holds a queue name, the throughput and the p99 batch latency; lines starting with # are ignored. */
+std::map<std::string, performance> read_baseline(const std::string& path)
+{
+    std::map<std::string, performance> baseline;
+
+    std::ifstream in{path};
+    if(!in)
+    {
+        throw std::runtime_error(fmt::format("cannot read baseline '{}'", path));
+    }
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream fields{line};
+        std::string name;
+        performance p;
+        if(fields >> name >> p.throughput >> p.p99_batch_us)
+        {
+            baseline[name] = p;
+        }
+    }
+
+    return baseline;
+}
+
+/** write a baseline file. */
+void write_baseline(const std::string& path, const options& opts, const std::vector<std::pair<std::string, performance>>& results)
+{
+    std::ofstream out_file{path};
+    if(!out_file)
+    {
+        throw std::runtime_error(fmt::format("cannot write baseline '{}'", path));
+    }
 
-            // run tasks.
-            dp.run_tasks_and_wait();
+    out_file << fmt::format("# test_thread_pool baseline: {} threads, {} tasks per batch, {} batches\n", opts.thread_count, opts.tasks, opts.batches);
+    out_file << "# queue tasks_per_second p99_batch_us\n";
+    for(auto& [name, p]: results)
+    {
+        out_file << fmt::format("{} {:.0f} {:.1f}\n", name, p.throughput, p.p99_batch_us);
+    }
+}
+
+/** measure all queue types, and compare against the baseline and/or record the results. */
+void run_performance(const options& opts)
+{
+    fmt::print("performance: {} threads, {} tasks per batch, {} batches\n", opts.thread_count, opts.tasks, opts.batches);
+
+    std::vector<std::pair<std::string, performance>> results;
+    results.emplace_back("spmc_queue", measure<concurrency_utils::spmc_queue<std::function<void()>>>(opts));
+    results.emplace_back("spmc_blocking_queue", measure<concurrency_utils::spmc_blocking_queue<std::function<void()>>>(opts));
+    results.emplace_back("mpmc_blocking_queue", measure<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>(opts));
+    results.emplace_back("work_stealing_queue", measure<concurrency_utils::work_stealing_queue<std::function<void()>>>(opts));
+    results.emplace_back("mpmc_bounded_queue", measure<concurrency_utils::mpmc_bounded_queue<std::function<void()>>>(opts));
+    results.emplace_back("mpmc_segmented_queue", measure<concurrency_utils::mpmc_segmented_queue<std::function<void()>>>(opts));
+    results.emplace_back("spmc_queue<inplace_task>", measure<concurrency_utils::spmc_queue<concurrency_utils::inplace_task<>>>(opts));
+
+    std::map<std::string, performance> baseline;
+    if(!opts.baseline_path.empty())
+    {
+        baseline = read_baseline(opts.baseline_path);
+    }
+
+    for(auto& [name, p]: results)
+    {
+        auto it = baseline.find(name);
+        if(it == baseline.end())
+        {
+            fmt::print("  {:<32} {:>10.3f} Mtasks/s  p99 {:>9.1f} us\n", name, p.throughput * 1e-6, p.p99_batch_us);
+            continue;
         }
 
-        auto current_time = std::chrono::steady_clock::now();
-        auto msec_delta_time = std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(current_time - msec_reference_time).count();
-        auto time_elapsed = std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(current_time - start_time).count();
+        auto& base = it->second;
+        bool slower = p.throughput < base.throughput * (1 - opts.tolerance);
+        bool later = p.p99_batch_us > base.p99_batch_us * (1 + opts.tolerance);
+
+        fmt::print("  {:<5} {:<26} {:>10.3f} Mtasks/s ({:+6.1f}%)  p99 {:>9.1f} us ({:+6.1f}%)\n",
+                   (slower || later) ? "FAIL" : "ok", name,
+                   p.throughput * 1e-6, 100 * (p.throughput / base.throughput - 1),
+                   p.p99_batch_us, 100 * (p.p99_batch_us / base.p99_batch_us - 1));
 
-        if(msec_delta_time > 2000)
+        if(slower || later)
         {
-            auto loops_per_second = static_cast<float>(1000 * loop_ctr) / (time_elapsed);
+            ++failed_checks;
+        }
+    }
+
+    if(!opts.record_path.empty())
+    {
+        write_baseline(opts.record_path, opts, results);
+        fmt::print("recorded baseline '{}'\n", opts.record_path);
+    }
+}
+
+/** program entry point. */
+int main(int argc, char* argv[])
+{
+    options opts;
+    if(!parse_options(argc, argv, opts))
+    {
+        print_usage();
+        return 2;
+    }
+
+    fmt::print("thread pool test: {} threads, {} tasks, {} iterations\n", opts.thread_count, opts.tasks, opts.iterations);
+
+    try
+    {
+        // bounded queues get a capacity below the batch size, so that pushing has to start the workers.
+        const std::size_t bounded_capacity = std::max<std::size_t>(opts.tasks / 4, 2);
+
+        check_deferred_pool<concurrency_utils::spmc_queue<std::function<void()>>>("spmc_queue", opts);
+        check_deferred_pool<concurrency_utils::spmc_blocking_queue<std::function<void()>>>("spmc_blocking_queue", opts);
+        check_deferred_pool<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>("mpmc_blocking_queue", opts);
+        check_deferred_pool<concurrency_utils::work_stealing_queue<std::function<void()>>>("work_stealing_queue", opts);
+        check_deferred_pool<concurrency_utils::mpmc_bounded_queue<std::function<void()>>>("mpmc_bounded_queue", opts, bounded_capacity);
+        check_deferred_pool<concurrency_utils::mpmc_segmented_queue<std::function<void()>>>("mpmc_segmented_queue", opts);
+        check_deferred_pool<concurrency_utils::priority_lane_queue<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>>("priority_lane_queue", opts);
+        check_deferred_pool<concurrency_utils::priority_lane_queue<concurrency_utils::mpmc_bounded_queue<std::function<void()>>>>("priority_lane_queue<bounded>", opts, bounded_capacity);
+        check_deferred_pool<concurrency_utils::spmc_queue<concurrency_utils::inplace_task<>>>("spmc_queue<inplace_task>", opts);
+        check_task_batch(opts);
+
+        check_continuous_pool<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>("mpmc_blocking_queue", opts);
+        check_continuous_pool<concurrency_utils::mpmc_bounded_queue<std::function<void()>>>("mpmc_bounded_queue", opts, bounded_capacity);
+        check_continuous_pool<concurrency_utils::mpmc_segmented_queue<std::function<void()>>>("mpmc_segmented_queue", opts);
+        check_continuous_pool<concurrency_utils::spmc_queue<std::function<void()>>>("spmc_queue", opts);
 
-            fmt::print("{:>6} loops  ({:#5.2f} loops per second)\n", loop_ctr, loops_per_second);
+#if defined(CONCURRENCY_UTILS_HAS_COROUTINES)
+        check_coroutines<concurrency_utils::deferred_thread_pool<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>>("deferred mpmc_blocking_queue", opts);
+        check_coroutines<concurrency_utils::continuous_thread_pool<concurrency_utils::mpmc_blocking_queue<std::function<void()>>>>("continuous mpmc_blocking_queue", opts);
+        check_coroutines<concurrency_utils::continuous_thread_pool<concurrency_utils::mpmc_bounded_queue<std::coroutine_handle<>>>>("continuous mpmc_bounded_queue", opts, bounded_capacity);
+#endif
 
-            msec_reference_time = std::chrono::steady_clock::now();
+        // odd worker counts leave merge runs (and chunks) without a partner.
+        for(std::size_t threads: {opts.thread_count, std::size_t{3}, std::size_t{5}})
+        {
+            check_parallel_loops(threads);
+            check_algorithms(threads);
         }
+
+        if(opts.perf)
+        {
+            run_performance(opts);
+        }
+    }
+    catch(const std::exception& e)
+    {
+        fmt::print("error: {}\n", e.what());
+        return EXIT_FAILURE;
     }
 
+    if(failed_checks != 0)
+    {
+        fmt::print("{} check(s) failed.\n", failed_checks);
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("all checks passed.\n");
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}